@@ -7,13 +7,20 @@
 
 // ----------------------------------------------------------------------------
 
-CayenneLPP::CayenneLPP(uint8_t size) : _maxsize(size) {
+CayenneLPP::CayenneLPP(uint8_t size) : _owned(true), _maxsize(size) {
   _buffer = (uint8_t *)malloc(size);
   _cursor = 0;
 }
 
+// Uses a caller provided buffer, no heap allocation
+CayenneLPP::CayenneLPP(uint8_t *buffer, uint8_t size)
+    : _buffer(buffer), _owned(false), _maxsize(size) {
+  _cursor = 0;
+}
+
 CayenneLPP::~CayenneLPP(void) {
-  free(_buffer);
+  if (_owned)
+    free(_buffer);
 }
 
 void CayenneLPP::reset(void) {
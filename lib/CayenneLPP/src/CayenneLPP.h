@@ -102,6 +102,7 @@ class CayenneLPP {
 
 public:
   CayenneLPP(uint8_t size);
+  CayenneLPP(uint8_t *buffer, uint8_t size);
   ~CayenneLPP();
 
   void reset(void);
@@ -211,6 +212,7 @@ protected:
   uint8_t addField(uint8_t type, uint8_t channel, T value);
 
   uint8_t *_buffer;
+  bool _owned;
   uint8_t _maxsize;
   uint8_t _cursor;
   uint8_t _error = LPP_ERROR_OK;
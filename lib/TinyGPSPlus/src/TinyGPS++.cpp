@@ -39,6 +39,7 @@ TinyGPSPlus::TinyGPSPlus()
   ,  curTermNumber(0)
   ,  curTermOffset(0)
   ,  sentenceHasFix(false)
+  ,  skipSentence(false)
   ,  customElts(0)
   ,  customCandidates(0)
   ,  encodedCharCount(0)
@@ -53,10 +54,62 @@ TinyGPSPlus::TinyGPSPlus()
 // public methods
 //
 
+void TinyGPSPlus::reset()
+{
+  TinyGPSCustom *elts = customElts;
+  *this = TinyGPSPlus();
+  customElts = elts;
+}
+
+// Drops the sentence being received, nothing is committed from it. Parsing
+// resumes with the next '$'.
+void TinyGPSPlus::resync()
+{
+  curSentenceType = GPS_SENTENCE_OTHER;
+  customCandidates = NULL;
+  curTermNumber = 1;
+  sentenceHasFix = false;
+  skipSentence = true;
+}
+
 bool TinyGPSPlus::encode(char c)
 {
   ++encodedCharCount;
+  return process(c);
+}
+
+// Processes a whole buffer. Sentences that are neither RMC nor GGA, and
+// that no TinyGPSCustom listens to, are skipped right after their address
+// field: no term copy, no checksum (they don't count in passedChecksum()
+// and failedChecksum()). Returns true if any sentence was validated.
+bool TinyGPSPlus::encode(const char *data, size_t len)
+{
+  const char *end = data + len;
+  bool isValidSentence = false;
+
+  encodedCharCount += len;
+  while (data < end)
+  {
+    if (skipSentence)
+    {
+      // memchr scans a word at a time
+      data = (const char *)memchr(data, '$', end - data);
+      if (data == NULL)
+        break;
+    }
+
+    if (process(*data++))
+      isValidSentence = true;
+  }
 
+  return isValidSentence;
+}
+
+//
+// internal utilities
+//
+bool TinyGPSPlus::process(char c)
+{
   switch(c)
   {
   case ',': // term terminators
@@ -84,6 +137,7 @@ bool TinyGPSPlus::encode(char c)
     curSentenceType = GPS_SENTENCE_OTHER;
     isChecksumTerm = false;
     sentenceHasFix = false;
+    skipSentence = false;
     return false;
 
   default: // ordinary characters
@@ -97,9 +151,6 @@ bool TinyGPSPlus::encode(char c)
   return false;
 }
 
-//
-// internal utilities
-//
 int TinyGPSPlus::fromHex(char a)
 {
   if (a >= 'A' && a <= 'F')
@@ -221,6 +272,9 @@ bool TinyGPSPlus::endOfTermHandler()
     if (customCandidates != NULL && strcmp(customCandidates->sentenceName, term) > 0)
        customCandidates = NULL;
 
+    // Nothing to extract from this sentence, encode(data, len) skips the rest
+    skipSentence = curSentenceType == GPS_SENTENCE_OTHER && customCandidates == NULL;
+
     return false;
   }
 
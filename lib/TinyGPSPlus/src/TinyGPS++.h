@@ -220,7 +220,10 @@ class TinyGPSPlus
 {
 public:
   TinyGPSPlus();
+  void reset(); // clear parsed data and statistics, keeps custom elements
   bool encode(char c); // process one character received from GPS
+  bool encode(const char *data, size_t len); // process a buffer received from GPS
+  void resync(); // drop the sentence being received, after characters were lost
   TinyGPSPlus &operator << (char c) {encode(c); return *this;}
 
   TinyGPSLocation location;
@@ -257,6 +260,7 @@ private:
   uint8_t curTermNumber;
   uint8_t curTermOffset;
   bool sentenceHasFix;
+  bool skipSentence;
 
   // custom element support
   friend class TinyGPSCustom;
@@ -272,6 +276,7 @@ private:
 
   // internal utilities
   int fromHex(char a);
+  bool process(char c);
   bool endOfTermHandler();
 };
 
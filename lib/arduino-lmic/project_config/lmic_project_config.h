@@ -8,6 +8,10 @@
 //#define CFG_in866 1
 #define CFG_sx1276_radio 1
 #define LMIC_USE_INTERRUPTS
+// The native_aes_* test environments select one of the other backends
+#if !defined(USE_ORIGINAL_AES) && !defined(USE_IDEETRON_AES)
+#define USE_TTABLE_AES
+#endif
 
 
 #define LMIC_LORAWAN_SPEC_VERSION    LMIC_LORAWAN_SPEC_VERSION_1_0_3
\ No newline at end of file
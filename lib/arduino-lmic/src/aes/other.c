@@ -38,6 +38,12 @@ void lmic_aes_encrypt(u1_t *data, u1_t *key);
 u4_t AESAUX[16/sizeof(u4_t)];
 u4_t AESKEY[16/sizeof(u4_t)];
 
+// CMAC subkey K1 of the last key used for a MIC. The MIC key only changes
+// when a session starts, so it is not derived again for every frame.
+static u1_t cmac_key[16];
+static u1_t cmac_k1[16];
+static u1_t cmac_k1_valid;
+
 // Shift the given buffer left one bit
 static void shift_left(xref2u1_t buf, u1_t len) {
     while (len--) {
@@ -78,18 +84,24 @@ static void os_aes_cmac(xref2u1_t buf, u2_t len, u1_t prepend_aux) {
             // by encrypting the all-zeroes block and then applying some
             // shifts and xor on that.
             u1_t final_key[16];
-            memset(final_key, 0, sizeof(final_key));
-            lmic_aes_encrypt(final_key, AESkey);
+            if (!cmac_k1_valid || memcmp(cmac_key, AESkey, 16) != 0) {
+                memset(cmac_k1, 0, sizeof(cmac_k1));
+                lmic_aes_encrypt(cmac_k1, AESkey);
+
+                // Calculate K1
+                u1_t msb = cmac_k1[0] & 0x80;
+                shift_left(cmac_k1, sizeof(cmac_k1));
+                if (msb)
+                    cmac_k1[sizeof(cmac_k1)-1] ^= 0x87;
 
-            // Calculate K1
-            u1_t msb = final_key[0] & 0x80;
-            shift_left(final_key, sizeof(final_key));
-            if (msb)
-                final_key[sizeof(final_key)-1] ^= 0x87;
+                memcpy(cmac_key, AESkey, 16);
+                cmac_k1_valid = 1;
+            }
+            memcpy(final_key, cmac_k1, sizeof(final_key));
 
             // If the final block was not complete, calculate K2 from K1
             if (need_padding) {
-                msb = final_key[0] & 0x80;
+                u1_t msb = final_key[0] & 0x80;
                 shift_left(final_key, sizeof(final_key));
                 if (msb)
                     final_key[sizeof(final_key)-1] ^= 0x87;
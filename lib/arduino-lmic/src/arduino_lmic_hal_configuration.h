@@ -88,10 +88,36 @@ public:
 		return 0;
 	}
 
+	// called on every radio opmode change with one of HAL_RADIO_*,
+	// e.g. to account the radio on-time. By default, do nothing.
+	virtual void radioMode(uint8_t mode) {
+		LMIC_API_PARAMETER(mode);
+	}
+
 	virtual void begin(void) {}
 	virtual void end(void) {}
 	virtual bool queryUsingTcxo(void) { return false; }
 
+	// platforms with a timer that keeps counting in low-power modes
+	// (RTC, LPTIM) can supply the LMIC time base here, in ticks of
+	// OSTICKS_PER_SEC. Return false to use micros().
+	virtual bool getTicks(uint32_t &ticks) {
+		LMIC_API_PARAMETER(ticks);
+		return false;
+	}
+
+	// called from hal_sleep() when the LMIC has nothing runnable.
+	// If fTimed is true, the next job is due in `ticks` ticks and the
+	// platform may sleep at most that long; otherwise only an
+	// interrupt can create new work. Returns the number of ticks that
+	// elapsed while the tick source was stopped, so the HAL can keep
+	// os_getTime() continuous. By default, don't sleep.
+	virtual ostime_t sleep(bool fTimed, ostime_t ticks) {
+		LMIC_API_PARAMETER(fTimed);
+		LMIC_API_PARAMETER(ticks);
+		return 0;
+	}
+
 	// compute desired transmit power policy.  HopeRF needs
 	// (and previous versions of this library always chose)
 	// PA_BOOST mode. So that's our default. Override this
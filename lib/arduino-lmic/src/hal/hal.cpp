@@ -223,7 +223,11 @@ static void hal_time_init () {
     // Nothing to do
 }
 
-u4_t hal_ticks () {
+// Ticks that micros() missed while the platform was stopped in
+// hal_sleep(); added to every hal_ticks() result.
+static u4_t sleep_ticks = 0;
+
+static u4_t hal_micros_ticks () {
     // Because micros() is scaled down in this function, micros() will
     // overflow before the tick timer should, causing the tick timer to
     // miss a significant part of its values if not corrected. To fix
@@ -261,13 +265,24 @@ u4_t hal_ticks () {
     // Return the scaled value with the upper bits of stored added. The
     // overlapping bit will be equal and the lower bits will be 0, so
     // bitwise or is a no-op for them.
-    return scaled | ((uint32_t)overflow << 24);
+    return (scaled | ((uint32_t)overflow << 24)) + sleep_ticks;
 
     // 0 leads to correct, but overly complex code (it could just return
     // micros() unmodified), 8 leaves no room for the overlapping bit.
     static_assert(US_PER_OSTICK_EXPONENT > 0 && US_PER_OSTICK_EXPONENT < 8, "Invalid US_PER_OSTICK_EXPONENT value");
 }
 
+u4_t hal_ticks () {
+    u4_t ticks;
+
+    // prefer a time base that survives low-power modes, if the
+    // platform has one.
+    if (pHalConfig != nullptr && pHalConfig->getTicks(ticks))
+        return ticks;
+
+    return hal_micros_ticks();
+}
+
 // Returns the number of ticks until time. Negative values indicate that
 // time has already passed.
 static s4_t delta_time(u4_t time) {
@@ -328,10 +343,21 @@ u4_t hal_waitUntil (u4_t time) {
     return 0;
 }
 
+// Target of the last hal_checkTimer() that had not yet expired; this
+// is how long hal_sleep() may sleep.
+static bool timer_armed = false;
+static u4_t timer_target;
+
 // check and rewind for target time
 u1_t hal_checkTimer (u4_t time) {
-    // No need to schedule wakeup, since we're not sleeping
-    return delta_time(time) <= 0;
+    if (delta_time(time) <= 0) {
+        timer_armed = false;
+        return 1;
+    }
+
+    timer_armed = true;
+    timer_target = time;
+    return 0;
 }
 
 static uint8_t irqlevel = 0;
@@ -365,8 +391,54 @@ uint8_t hal_getIrqLevel(void) {
     return irqlevel;
 }
 
+// Wake up this long before the next deadline, to cover the platform's
+// wakeup latency (clock restart, RTC alarm granularity).
+#ifndef LMIC_HAL_SLEEP_GUARD_TICKS
+# define LMIC_HAL_SLEEP_GUARD_TICKS ms2osticks(20)
+#endif
+
+// Don't bother sleeping for less than this; just keep polling.
+#ifndef LMIC_HAL_SLEEP_MIN_TICKS
+# define LMIC_HAL_SLEEP_MIN_TICKS ms2osticks(10)
+#endif
+
+// Called by os_runloop_once() with interrupts disabled, when there is
+// no runnable job. If a timed job is pending, hal_checkTimer() has just
+// recorded its deadline.
 void hal_sleep () {
-    // Not implemented
+    bool const fTimed = timer_armed;
+    s4_t ticks = 0;
+
+    timer_armed = false;
+    if (fTimed) {
+        ticks = delta_time(timer_target) - LMIC_HAL_SLEEP_GUARD_TICKS;
+        if (ticks < LMIC_HAL_SLEEP_MIN_TICKS)
+            return;
+    }
+
+    // remember which DIO lines were already stamped before sleeping.
+    bool stamped[NUM_DIO_INTERRUPT];
+    for (uint8_t i = 0; i < NUM_DIO_INTERRUPT; ++i)
+        stamped[i] = interrupt_time[i] != 0;
+
+    ostime_t const missed = pHalConfig->sleep(fTimed, ticks);
+
+    // the platform may have re-enabled interrupts to wake up; we're
+    // still inside os_runloop_once()'s critical section.
+    noInterrupts();
+    if (missed <= 0)
+        return;
+
+    sleep_ticks += missed;
+
+    // DIO edges that woke us were stamped before the time base was
+    // corrected; move them forward so radio timing stays exact.
+    for (uint8_t i = 0; i < NUM_DIO_INTERRUPT; ++i) {
+        if (! stamped[i] && interrupt_time[i] != 0) {
+            ostime_t const t = interrupt_time[i] + missed;
+            interrupt_time[i] = t ? t : 1;
+        }
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -495,6 +567,10 @@ ostime_t hal_setModuleActive (bit_t val) {
     return pHalConfig->setModuleActive(val);
 }
 
+void hal_radioMode (u1_t mode) {
+    pHalConfig->radioMode(mode);
+}
+
 bit_t hal_queryUsingTcxo(void) {
     return pHalConfig->queryUsingTcxo();
 }
@@ -142,13 +142,20 @@
 // byte-oriented ones, making it use a lot less flash space (but it is
 // also about twice as slow as the original).
 // #define USE_IDEETRON_AES
-
-#if ! (defined(USE_ORIGINAL_AES) || defined(USE_IDEETRON_AES))
+//
+// This selects a word-oriented implementation using a single 1 KiB
+// lookup table in flash, which caches the expanded session keys. It is
+// meant for 32-bit cores such as the Cortex-M0+, where it is several
+// times faster than the Ideetron one for a small amount of flash and
+// 360 bytes of RAM.
+// #define USE_TTABLE_AES
+
+#if ! (defined(USE_ORIGINAL_AES) || defined(USE_IDEETRON_AES) || defined(USE_TTABLE_AES))
 # define USE_IDEETRON_AES
 #endif
 
-#if defined(USE_ORIGINAL_AES) && defined(USE_IDEETRON_AES)
-# error "You may define at most one of USE_ORIGINAL_AES and USE_IDEETRON_AES"
+#if (defined(USE_ORIGINAL_AES) + defined(USE_IDEETRON_AES) + defined(USE_TTABLE_AES)) > 1
+# error "You may define at most one of USE_ORIGINAL_AES, USE_IDEETRON_AES and USE_TTABLE_AES"
 #endif
 
 // LMIC_DISABLE_DR_LEGACY
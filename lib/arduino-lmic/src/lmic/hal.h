@@ -148,6 +148,21 @@ s1_t hal_getRssiCal (void);
  */
 ostime_t hal_setModuleActive (bit_t val);
 
+/* radio operating modes reported to hal_radioMode() */
+enum	{
+	HAL_RADIO_SLEEP		= 0,
+	HAL_RADIO_STANDBY	= 1,
+	HAL_RADIO_TX		= 2,
+	HAL_RADIO_RX		= 3,
+};
+
+/*
+ * report a change of the radio operating mode, one of HAL_RADIO_*.
+ * Called on every opmode write, LMIC.rps holds the current radio
+ * parameters.
+ */
+void hal_radioMode (u1_t mode);
+
 /* find out if we're using Tcxo */
 bit_t hal_queryUsingTcxo(void);
 
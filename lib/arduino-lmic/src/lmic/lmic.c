@@ -915,9 +915,8 @@ scan_mac_cmds(
 
         switch( cmd ) {
         case MCMD_LinkCheckAns: {
-            // TODO(tmm@mcci.com) capture these, reliably..
-            //int gwmargin = opts[oidx+1];
-            //int ngws = opts[oidx+2];
+            LMIC.linkCheckMargin = opts[oidx+1];
+            LMIC.linkCheckGwCnt = opts[oidx+2];
             break;
         }
         // from 1.0.3 spec section 5.2:
@@ -1899,6 +1898,12 @@ static bit_t buildDataFrame (void) {
     }
 #endif // !DISABLE_MCMD_RXTimingSetupReq)
 
+    if ( LMIC.txLinkCheckReq ) {
+        LMIC.frame[end+0] = MCMD_LinkCheckReq;
+        end += 1;
+        LMIC.txLinkCheckReq = 0;
+        LMIC.linkCheckGwCnt = 0;
+    }
 #if LMIC_ENABLE_DeviceTimeReq
     if ( LMIC.txDeviceTimeReqState == lmic_RequestTimeState_tx ) {
         LMIC.frame[end+0] = MCMD_DeviceTimeReq;
@@ -3035,6 +3040,13 @@ void LMIC_setLinkCheckMode (bit_t enabled) {
     LMIC.adrAckReq = enabled ? LINK_CHECK_INIT : LINK_CHECK_OFF;
 }
 
+// Piggybacks a LinkCheckReq on the next uplink. The answer, if any, is in
+// LMIC.linkCheckMargin and LMIC.linkCheckGwCnt when EV_TXCOMPLETE is reported;
+// LMIC.linkCheckGwCnt stays 0 if the network did not answer.
+void LMIC_requestLinkCheck (void) {
+    LMIC.txLinkCheckReq = 1;
+}
+
 // Sets the max clock error to compensate for (defaults to 0, which
 // allows for +/- 640 at SF7BW250). MAX_CLOCK_ERROR represents +/-100%,
 // so e.g. for a +/-1% error you would pass MAX_CLOCK_ERROR * 1 / 100.
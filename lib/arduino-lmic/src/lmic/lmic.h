@@ -627,6 +627,9 @@ struct lmic_t {
 
     u1_t        margin;
     s1_t        devAnsMargin; // SNR value between -32 and 31 (inclusive) for the last successfully received DevStatusReq command
+    u1_t        txLinkCheckReq;   // LinkCheckReq to piggyback on the next uplink
+    u1_t        linkCheckMargin;  // demodulation margin in dB from the last LinkCheckAns
+    u1_t        linkCheckGwCnt;   // gateways from the last LinkCheckAns, 0 if not answered
     u1_t        adrEnabled;
     u1_t        moreData;     // NWK has more data pending
 #if LMIC_ENABLE_TxParamSetupReq
@@ -726,6 +729,7 @@ void  LMIC_setPingable   (u1_t intvExp);
 
 void LMIC_setSession (u4_t netid, devaddr_t devaddr, xref2u1_t nwkKey, xref2u1_t artKey);
 void LMIC_setLinkCheckMode (bit_t enabled);
+void LMIC_requestLinkCheck (void);
 void LMIC_setClockError(u2_t error);
 
 u4_t LMIC_getSeqnoUp    (void);
@@ -403,11 +403,25 @@ static void requestModuleActive(bit_t state) {
         hal_waitUntil(os_getTime() + ticks);;
 }
 
+// HAL_RADIO_* mode reported for each OPMODE_* value; the frequency
+// synthesis modes only last until the following TX or RX.
+static const u1_t halRadioModes[] = {
+    [OPMODE_SLEEP]     = HAL_RADIO_SLEEP,
+    [OPMODE_STANDBY]   = HAL_RADIO_STANDBY,
+    [OPMODE_FSTX]      = HAL_RADIO_STANDBY,
+    [OPMODE_TX]        = HAL_RADIO_TX,
+    [OPMODE_FSRX]      = HAL_RADIO_STANDBY,
+    [OPMODE_RX]        = HAL_RADIO_RX,
+    [OPMODE_RX_SINGLE] = HAL_RADIO_RX,
+    [OPMODE_CAD]       = HAL_RADIO_RX,
+};
+
 static void writeOpmode(u1_t mode) {
     u1_t const maskedMode = mode & OPMODE_MASK;
     if (maskedMode != OPMODE_SLEEP)
         requestModuleActive(1);
     writeReg(RegOpMode, mode);
+    hal_radioMode(halRadioModes[maskedMode]);
     if (maskedMode == OPMODE_SLEEP)
         requestModuleActive(0);
 }
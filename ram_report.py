@@ -0,0 +1,30 @@
+# PlatformIO post-build script: prints the static RAM usage of the firmware and
+# the largest RAM symbols, so that RAM growth is visible on every build.
+# All long-lived objects are static, the heap in use after boot is printed by
+# the firmware itself on the serial port.
+
+import subprocess
+
+Import("env")
+
+TOP_SYMBOLS = 12
+
+
+def ram_report(source, target, env):
+    elf = str(target[0])
+    nm = env.subst("$CC").replace("gcc", "nm")
+    out = subprocess.run([nm, "-S", "-C", "--size-sort", elf],
+                         capture_output=True, text=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        fields = line.split(None, 3)
+        # address size type name, RAM symbols are in .data (d/D) or .bss (b/B)
+        if len(fields) == 4 and fields[2] in "bBdD":
+            symbols.append((int(fields[1], 16), fields[3]))
+    total = sum(size for size, _ in symbols)
+    print("RAM report: %d bytes in static data (.data + .bss)" % total)
+    for size, name in sorted(symbols, reverse=True)[:TOP_SYMBOLS]:
+        print("  %6d  %s" % (size, name))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", ram_report)
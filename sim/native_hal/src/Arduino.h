@@ -0,0 +1,113 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/*
+ * Stand-in for the STM32 Arduino core, for the native build. The board pins are
+ * numbered like the Nucleo-L073RZ variant and wired to the models of sim.h.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "stm32_def.h"
+
+#ifdef __cplusplus
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+#endif
+
+enum
+{
+    PA0, PA1, PA2, PA3, PA4, PA5, PA6, PA7, PA8, PA9, PA10, PA11, PA12, PA13, PA14, PA15,
+    PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7, PB8, PB9, PB10, PB11, PB12, PB13, PB14, PB15,
+    PC0, PC1, PC2, PC3, PC4, PC5, PC6, PC7, PC8, PC9, PC10, PC11, PC12, PC13, PC14, PC15,
+    PD2, PH0, PH1,
+    NUM_DIGITAL_PINS,
+};
+#define NC 0xFFFFFFFF
+
+#define LOW 0
+#define HIGH 1
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define INPUT_PULLDOWN 0x3
+#define INPUT_ANALOG 0x4
+#define OUTPUT_OPEN_DRAIN 0x5
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strlen_P strlen
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define digitalPinToInterrupt(p) (p)
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#ifdef __cplusplus
+template <class T, class L>
+auto min(const T &a, const L &b) -> decltype(b < a ? b : a)
+{
+    return b < a ? b : a;
+}
+
+template <class T, class L>
+auto max(const T &a, const L &b) -> decltype(b < a ? a : b)
+{
+    return b < a ? a : b;
+}
+
+extern "C" {
+#endif
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+uint32_t analogRead(uint32_t pin);
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode);
+void detachInterrupt(uint32_t pin);
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield(void);
+
+void interrupts(void);
+void noInterrupts(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
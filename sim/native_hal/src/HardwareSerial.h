@@ -0,0 +1,54 @@
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Stream.h"
+#include "stm32l0xx_hal.h"
+
+// Stand-in for the STM32 core serial ports, see sim_uart_attach()
+
+#define SERIAL_RX_BUFFER_SIZE 64
+
+typedef struct
+{
+    UART_HandleTypeDef handle;
+    uint32_t pin_rx;
+    uint32_t pin_tx;
+} serial_t;
+
+class HardwareSerial : public Stream
+{
+public:
+    HardwareSerial(uint32_t rx, uint32_t tx);
+    ~HardwareSerial();
+    void begin(unsigned long baud);
+    void end(void);
+    int available(void) override;
+    int peek(void) override;
+    int read(void) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    operator bool() { return true; }
+
+    void receive(const uint8_t *data, size_t len);
+    uint32_t byte_time_us(void) const;
+    static HardwareSerial *find(uint32_t pin);
+
+    // Protected like in the core, the drivers reach the UART handle from a subclass
+protected:
+    serial_t _serial;
+    friend class STM32LowPower;
+
+private:
+    unsigned long _baud = 0;
+    bool _console;
+    bool _line_start = true;
+    uint8_t _rx_buf[SERIAL_RX_BUFFER_SIZE];
+    uint16_t _rx_head = 0;
+    uint16_t _rx_tail = 0;
+    HardwareSerial *_next;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include <Arduino.h>
+
+// Stand-in for the Arduino SPI library, the devices are sim_spi_attach() models
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+class SPISettings
+{
+public:
+    SPISettings(uint32_t clock = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+        : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+    uint32_t clock;
+    uint8_t bitOrder;
+    uint8_t dataMode;
+};
+
+class SPIClass
+{
+public:
+    void begin(void) {}
+    void end(void) {}
+    void setMISO(uint32_t pin) { (void)pin; }
+    void setMOSI(uint32_t pin) { (void)pin; }
+    void setSCLK(uint32_t pin) { (void)pin; }
+    void setSSEL(uint32_t pin) { (void)pin; }
+    void setBitOrder(uint8_t order) { (void)order; }
+    void setDataMode(uint8_t mode) { (void)mode; }
+    void setClockDivider(uint8_t div) { _clock = 16000000 / (div ? div : 1); }
+    void beginTransaction(SPISettings settings) { _clock = settings.clock; }
+    void endTransaction(void) {}
+    uint8_t transfer(uint8_t data);
+    void transfer(void *buf, size_t count);
+
+private:
+    uint32_t _clock = 4000000;
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _STM32_LOW_POWER_H_
+#define _STM32_LOW_POWER_H_
+
+#include <Arduino.h>
+#include <STM32RTC.h>
+
+// Stand-in for the STM32LowPower library, the sleep modes idle on the virtual clock
+
+typedef void (*voidFuncPtrVoid)(void);
+
+enum LP_Mode : uint8_t
+{
+    IDLE_MODE,
+    SLEEP_MODE,
+    DEEP_SLEEP_MODE,
+    SHUTDOWN_MODE,
+};
+
+class STM32LowPower
+{
+public:
+    void begin(void) {}
+    void idle(uint32_t ms = 0) { sleep(ms); }
+    void sleep(uint32_t ms = 0);
+    void deepSleep(uint32_t ms = 0);
+    void shutdown(uint32_t ms = 0) { deepSleep(ms); }
+    void attachInterruptWakeup(uint32_t pin, voidFuncPtrVoid callback, uint32_t mode,
+                               LP_Mode LowPowerMode = SHUTDOWN_MODE);
+};
+
+extern STM32LowPower LowPower;
+
+#endif
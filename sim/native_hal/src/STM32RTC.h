@@ -0,0 +1,45 @@
+#ifndef __STM32_RTC_H
+#define __STM32_RTC_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// Stand-in for the STM32duino RTC library, the calendar follows the virtual clock
+
+class STM32RTC
+{
+public:
+    enum Hour_Format : uint8_t
+    {
+        HOUR_12,
+        HOUR_24,
+    };
+
+    enum Source_Clock : uint8_t
+    {
+        LSI_CLOCK,
+        LSE_CLOCK,
+        HSE_CLOCK,
+    };
+
+    static STM32RTC &getInstance(void)
+    {
+        static STM32RTC instance;
+        return instance;
+    }
+
+    void setClockSource(Source_Clock source) { (void)source; }
+    void begin(bool resetTime = false, Hour_Format format = HOUR_24);
+    void end(void) {}
+    bool isTimeSet(void) { return _time_set; }
+    time_t getEpoch(uint32_t *subSeconds = nullptr);
+    void setEpoch(time_t ts, uint32_t subSeconds = 0);
+
+private:
+    STM32RTC() {}
+    // Epoch at power on, the RTC starts on 2000-01-01 until set
+    int64_t _epoch_us = 946684800LL * 1000000;
+    bool _time_set = false;
+};
+
+#endif /* __STM32_RTC_H */
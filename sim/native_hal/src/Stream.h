@@ -0,0 +1,16 @@
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+// Stand-in for the Arduino Stream class, the input side of the serial ports and of Wire
+
+class Stream : public Print
+{
+public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef String_class_h
+#define String_class_h
+
+#include <string>
+
+// Stand-in for the Arduino String class
+
+class String
+{
+public:
+    String(const char *s = "") : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int n) : _s(std::to_string(n)) {}
+    explicit String(unsigned n) : _s(std::to_string(n)) {}
+    explicit String(long n) : _s(std::to_string(n)) {}
+    explicit String(unsigned long n) : _s(std::to_string(n)) {}
+    explicit String(double n, unsigned char digits = 2);
+
+    const char *c_str(void) const { return _s.c_str(); }
+    unsigned int length(void) const { return _s.length(); }
+    char operator[](unsigned int i) const { return _s[i]; }
+    bool concat(const char *s) { _s += s; return true; }
+    bool concat(const char *s, unsigned int len) { _s.append(s, len); return true; }
+    bool concat(char c) { _s += c; return true; }
+    bool operator==(const String &rhs) const { return _s == rhs._s; }
+    bool operator!=(const String &rhs) const { return _s != rhs._s; }
+    bool operator<(const String &rhs) const { return _s < rhs._s; }
+
+    String &operator+=(const String &rhs) { _s += rhs._s; return *this; }
+    String &operator+=(const char *rhs) { _s += rhs; return *this; }
+    String &operator+=(char c) { _s += c; return *this; }
+    String &operator+=(int n) { _s += std::to_string(n); return *this; }
+    String &operator+=(unsigned n) { _s += std::to_string(n); return *this; }
+    String &operator+=(long n) { _s += std::to_string(n); return *this; }
+    String &operator+=(unsigned long n) { _s += std::to_string(n); return *this; }
+
+private:
+    std::string _s;
+};
+
+// Result of a concatenation, as in the Arduino core
+class StringSumHelper : public String
+{
+public:
+    StringSumHelper(const String &s) : String(s) {}
+};
+
+template <typename T>
+StringSumHelper operator+(const String &lhs, const T &rhs)
+{
+    StringSumHelper s(lhs);
+    s += rhs;
+    return s;
+}
+
+#endif
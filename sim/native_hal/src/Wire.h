@@ -0,0 +1,56 @@
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <Arduino.h>
+
+// Stand-in for the Arduino Wire library, the devices are sim_i2c_attach() models
+
+#define BUFFER_LENGTH 256
+
+typedef struct
+{
+    I2C_HandleTypeDef handle;
+} i2c_t;
+
+class TwoWire : public Stream
+{
+public:
+    void begin(void)
+    {
+        setClock(100000);
+        _i2c.handle.State = HAL_I2C_STATE_READY;
+    }
+    void begin(uint8_t address) { (void)address; begin(); }
+    void end(void) { _i2c.handle.State = HAL_I2C_STATE_RESET; }
+    void setClock(uint32_t clock) { _clock = clock; _i2c.handle.Init.Timing = clock; }
+    i2c_t *getHandle(void) { return &_i2c; }
+    void setSCL(uint32_t pin) { (void)pin; }
+    void setSDA(uint32_t pin) { (void)pin; }
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (uint8_t)quantity); }
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t *data, size_t quantity) override;
+    using Print::write;
+    int available(void) override { return _rx_len - _rx_pos; }
+    int read(void) override { return _rx_pos < _rx_len ? _rx_buf[_rx_pos++] : -1; }
+    int peek(void) override { return _rx_pos < _rx_len ? _rx_buf[_rx_pos] : -1; }
+
+private:
+    void bus_time(size_t bytes);
+
+    i2c_t _i2c = {};
+    uint32_t _clock = 100000;
+    uint8_t _address = 0;
+    uint8_t _tx_buf[BUFFER_LENGTH];
+    size_t _tx_len = 0;
+    uint8_t _rx_buf[BUFFER_LENGTH];
+    size_t _rx_len = 0;
+    size_t _rx_pos = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,446 @@
+#include <stdarg.h>
+#include <Arduino.h>
+#include "sim.h"
+
+/*
+ * Arduino core on the virtual clock: pins, time, interrupts and serial ports.
+ */
+
+#define SIM_PIN_WATCHERS 16
+#define SIM_UART_DEVICES 4
+
+struct SimPin
+{
+    uint8_t mode;
+    uint8_t out;       // Level written by the firmware
+    int8_t driven;     // Level driven by a model, -1 if floating
+    uint8_t isr_mode;
+    void (*isr)(void);
+};
+
+struct SimPinWatch
+{
+    uint32_t pin;
+    void (*fn)(uint32_t pin, int level);
+};
+
+struct SimUartDevice
+{
+    uint32_t tx_pin;
+    void (*fn)(const uint8_t *data, size_t len);
+};
+
+static SimPin sim_pins[NUM_DIGITAL_PINS];
+static SimPinWatch sim_watches[SIM_PIN_WATCHERS];
+static int sim_watch_count = 0;
+static SimUartDevice sim_uarts[SIM_UART_DEVICES];
+static int sim_uart_count = 0;
+static HardwareSerial *sim_serials = nullptr;
+
+HardwareSerial Serial(NC, NC);
+
+static int sim_pin_read(const SimPin &p)
+{
+    if (p.mode == OUTPUT || p.mode == OUTPUT_OPEN_DRAIN)
+        return p.out;
+    if (p.driven >= 0)
+        return p.driven;
+    return p.mode == INPUT_PULLUP;
+}
+
+static void sim_pin_changed(uint32_t pin, int level)
+{
+    for (int i = 0; i < sim_watch_count; i++)
+        if (sim_watches[i].pin == pin)
+            sim_watches[i].fn(pin, level);
+}
+
+void pinMode(uint32_t pin, uint32_t mode)
+{
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    SimPin &p = sim_pins[pin];
+    int before = sim_pin_read(p);
+    p.mode = mode;
+    int after = sim_pin_read(p);
+    if (after != before)
+        sim_pin_changed(pin, after);
+}
+
+void digitalWrite(uint32_t pin, uint32_t value)
+{
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    SimPin &p = sim_pins[pin];
+    int before = sim_pin_read(p);
+    p.out = value ? HIGH : LOW;
+    int after = sim_pin_read(p);
+    if (after != before)
+        sim_pin_changed(pin, after);
+}
+
+int digitalRead(uint32_t pin)
+{
+    if (pin >= NUM_DIGITAL_PINS)
+        return LOW;
+    return sim_pin_read(sim_pins[pin]);
+}
+
+uint32_t analogRead(uint32_t pin)
+{
+    // 10-bit resolution, like the Arduino default
+    if (pin == PC4)
+        return (uint32_t)(sim_opt.battery_v / 2 / 3.3 * 1023);
+    return 0;
+}
+
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode)
+{
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    sim_pins[pin].isr = callback;
+    sim_pins[pin].isr_mode = mode;
+}
+
+void detachInterrupt(uint32_t pin)
+{
+    if (pin < NUM_DIGITAL_PINS)
+        sim_pins[pin].isr = nullptr;
+}
+
+/**
+ * @brief Drives an input pin from a model, raising its EXTI interrupt on a matching edge.
+ *
+ * @param pin The pin.
+ * @param level The level, or -1 to leave the pin floating.
+ */
+void sim_pin_drive(uint32_t pin, int level)
+{
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    SimPin &p = sim_pins[pin];
+    int before = sim_pin_read(p);
+    p.driven = level;
+    int after = sim_pin_read(p);
+    if (after == before)
+        return;
+
+    sim_pin_changed(pin, after);
+    if (p.isr != nullptr && (p.isr_mode == CHANGE || (p.isr_mode == RISING && after) ||
+                             (p.isr_mode == FALLING && !after)))
+        sim_irq(p.isr, true);
+}
+
+/**
+ * @brief Returns the level of a pin, as the firmware drives or reads it.
+ */
+int sim_pin_level(uint32_t pin)
+{
+    return digitalRead(pin);
+}
+
+/**
+ * @brief Calls a model function every time the level of a pin changes.
+ */
+void sim_pin_watch(uint32_t pin, void (*fn)(uint32_t pin, int level))
+{
+    if (sim_watch_count < SIM_PIN_WATCHERS)
+        sim_watches[sim_watch_count++] = {pin, fn};
+}
+
+static void sim_pins_init(void) __attribute__((constructor));
+static void sim_pins_init(void)
+{
+    for (int i = 0; i < NUM_DIGITAL_PINS; i++)
+        sim_pins[i].driven = -1;
+}
+
+uint32_t millis(void)
+{
+    return (uint32_t)(sim_systick() / 1000);
+}
+
+uint32_t micros(void)
+{
+    return (uint32_t)sim_systick();
+}
+
+void delay(uint32_t ms)
+{
+    sim_busy((simtime_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    sim_busy(us);
+}
+
+void yield(void)
+{
+}
+
+void interrupts(void)
+{
+    sim_irq_enable(true);
+}
+
+void noInterrupts(void)
+{
+    sim_irq_enable(false);
+}
+
+String::String(double n, unsigned char digits)
+{
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    _s = buf;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+        n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(long n, int base)
+{
+    if (n < 0 && base == DEC)
+        return print('-') + print((unsigned long)-n, base);
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    char buf[8 * sizeof(long) + 1];
+    char *s = &buf[sizeof(buf) - 1];
+    *s = '\0';
+    if (base < 2)
+        base = 10;
+    do
+    {
+        unsigned d = n % base;
+        *--s = d < 10 ? '0' + d : 'A' + d - 10;
+        n /= base;
+    } while (n);
+    return write(s);
+}
+
+size_t Print::print(double n, int digits)
+{
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+}
+
+int Print::printf(const char *format, ...)
+{
+    char buf[256];
+    va_list ap;
+    va_start(ap, format);
+    int len = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+    if (len > (int)sizeof(buf) - 1)
+        len = sizeof(buf) - 1;
+    return len < 0 ? len : write((const uint8_t *)buf, len);
+}
+
+/**
+ * @brief Connects a model to the TX line of a serial port.
+ *
+ * @param tx_pin TX pin of the port.
+ * @param fn Function receiving what the firmware sends.
+ */
+void sim_uart_attach(uint32_t tx_pin, void (*fn)(const uint8_t *data, size_t len))
+{
+    if (sim_uart_count < SIM_UART_DEVICES)
+        sim_uarts[sim_uart_count++] = {tx_pin, fn};
+}
+
+/**
+ * @brief Sends characters from a model to the firmware.
+ *
+ * @param rx_pin RX pin of the port.
+ */
+void sim_uart_send(uint32_t rx_pin, const uint8_t *data, size_t len)
+{
+    HardwareSerial *port = HardwareSerial::find(rx_pin);
+    if (port != nullptr)
+        port->receive(data, len);
+}
+
+static void sim_uart_irq(void)
+{
+}
+
+HardwareSerial::HardwareSerial(uint32_t rx, uint32_t tx)
+{
+    memset(&_serial, 0, sizeof(_serial));
+    _serial.pin_rx = rx;
+    _serial.pin_tx = tx;
+    _console = rx == NC;
+    _next = sim_serials;
+    sim_serials = this;
+}
+
+HardwareSerial::~HardwareSerial()
+{
+    for (HardwareSerial **p = &sim_serials; *p != nullptr; p = &(*p)->_next)
+        if (*p == this)
+        {
+            *p = _next;
+            break;
+        }
+}
+
+HardwareSerial *HardwareSerial::find(uint32_t pin)
+{
+    for (HardwareSerial *p = sim_serials; p != nullptr; p = p->_next)
+        if (p->_serial.pin_rx == pin)
+            return p;
+    return nullptr;
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    _baud = baud;
+    _rx_head = _rx_tail = 0;
+    // Interrupt driven reception, one character at a time
+    _serial.handle.hdmarx = nullptr;
+    _serial.handle.ReceptionType = HAL_UART_RECEPTION_STANDARD;
+    _serial.handle.RxState = HAL_UART_STATE_BUSY_RX;
+}
+
+void HardwareSerial::end(void)
+{
+    _baud = 0;
+    _serial.handle.RxState = HAL_UART_STATE_RESET;
+}
+
+int HardwareSerial::available(void)
+{
+    return (uint16_t)(_rx_head - _rx_tail) % SERIAL_RX_BUFFER_SIZE;
+}
+
+int HardwareSerial::peek(void)
+{
+    return available() ? _rx_buf[_rx_tail] : -1;
+}
+
+int HardwareSerial::read(void)
+{
+    if (!available())
+        return -1;
+    uint8_t c = _rx_buf[_rx_tail];
+    _rx_tail = (_rx_tail + 1) % SERIAL_RX_BUFFER_SIZE;
+    return c;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+/**
+ * @brief Sends characters, to the console (stdout) or to the model on the TX line.
+ *
+ * The console lines are stamped with the virtual time in seconds. Bytes with bit 7 set
+ * belong to the binary trace records (src/trace.cpp) and are written unchanged, for
+ * tools/trace_decoder.py.
+ */
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (!_console)
+    {
+        if (_baud == 0)
+            return 0;
+        for (int i = 0; i < sim_uart_count; i++)
+            if (sim_uarts[i].tx_pin == _serial.pin_tx)
+                sim_uarts[i].fn(buffer, size);
+        return size;
+    }
+
+    if (sim_opt.quiet)
+        return size;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (buffer[i] & 0x80)
+        {
+            ::putchar(buffer[i]);
+            continue;
+        }
+        if (_line_start)
+        {
+            ::printf("[%11.6f] ", sim_now() / 1e6);
+            _line_start = false;
+        }
+        if (buffer[i] == '\r')
+            continue;
+        ::putchar(buffer[i]);
+        _line_start = buffer[i] == '\n';
+    }
+    return size;
+}
+
+/**
+ * @brief Receives characters from the model on the RX line.
+ *
+ * The characters go to the DMA buffer when a reception to idle by DMA is running,
+ * otherwise to the receive buffer read by read().
+ */
+void HardwareSerial::receive(const uint8_t *data, size_t len)
+{
+    UART_HandleTypeDef *huart = &_serial.handle;
+    if (_baud == 0 || huart->RxState != HAL_UART_STATE_BUSY_RX)
+        return;
+
+    if (huart->ReceptionType != HAL_UART_RECEPTION_TOIDLE || huart->hdmarx == nullptr)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            uint16_t next = (_rx_head + 1) % SERIAL_RX_BUFFER_SIZE;
+            if (next == _rx_tail)
+                break;
+            _rx_buf[_rx_head] = data[i];
+            _rx_head = next;
+        }
+        sim_irq(sim_uart_irq, false);
+        return;
+    }
+
+    DMA_HandleTypeDef *hdma = huart->hdmarx;
+    DMA_Channel_TypeDef *ch = hdma->Instance;
+    int n = ch - sim_DMA1_Channel + 1;
+    uint16_t half = huart->RxXferSize / 2;
+    for (size_t i = 0; i < len; i++)
+    {
+        huart->pRxBuffPtr[huart->RxXferSize - ch->CNDTR] = data[i];
+        if (--ch->CNDTR == half)
+        {
+            DMA1->ISR |= SIM_DMA_FLAG_HT(n);
+            sim_nvic_raise(DMA1_Channel4_5_6_7_IRQn, false);
+        }
+        else if (ch->CNDTR == 0)
+        {
+            DMA1->ISR |= SIM_DMA_FLAG_TC(n);
+            sim_nvic_raise(DMA1_Channel4_5_6_7_IRQn, false);
+            if (hdma->Init.Mode != DMA_CIRCULAR)
+            {
+                huart->RxState = HAL_UART_STATE_READY;
+                return;
+            }
+            ch->CNDTR = huart->RxXferSize;
+        }
+    }
+    // Idle line once the burst is over
+    sim_irq(sim_uart_irq, false);
+}
+
+/**
+ * @brief Returns the time taken by one character, 8N1.
+ */
+uint32_t HardwareSerial::byte_time_us(void) const
+{
+    return _baud ? (10 * 1000000 + _baud - 1) / _baud : 0;
+}
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include "sim.h"
+
+/*
+ * T-Impulse board wiring (see src/config.h) and the touch pad.
+ */
+
+#define SIM_TOUCH_OUT PA0
+#define SIM_TOUCH_VDD PA2
+#define SIM_TOUCH_PRESSES 32
+
+struct SimPress
+{
+    simtime_t at;
+    simtime_t len;
+};
+
+static SimPress sim_presses[SIM_TOUCH_PRESSES];
+static int sim_press_count = 0;
+
+static void sim_touch_release(void *arg)
+{
+    (void)arg;
+    sim_pin_drive(SIM_TOUCH_OUT, LOW);
+}
+
+static void sim_touch_event(void *arg)
+{
+    SimPress *press = (SimPress *)arg;
+    // The TTP223 output only follows the pad while it is powered
+    if (sim_pin_level(SIM_TOUCH_VDD) != HIGH)
+        return;
+    sim_pin_drive(SIM_TOUCH_OUT, HIGH);
+    sim_at(sim_now() + press->len, sim_touch_release, nullptr);
+}
+
+/**
+ * @brief Schedules a press on the touch pad.
+ *
+ * @param at_s Time of the press in seconds.
+ * @param ms Duration of the press in milliseconds.
+ */
+void sim_touch_press(double at_s, double ms)
+{
+    if (sim_press_count == SIM_TOUCH_PRESSES)
+        return;
+    SimPress *press = &sim_presses[sim_press_count++];
+    press->at = (simtime_t)(at_s * 1e6);
+    press->len = (simtime_t)(ms * 1e3);
+    sim_at(press->at, sim_touch_event, press);
+}
+
+/**
+ * @brief Sets the board up before the firmware starts.
+ */
+void sim_board_init(void)
+{
+    sim_pin_drive(SIM_TOUCH_OUT, LOW);
+    srand(sim_opt.seed);
+}
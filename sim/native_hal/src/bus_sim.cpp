@@ -0,0 +1,211 @@
+#include <SPI.h>
+#include <Wire.h>
+#include "sim.h"
+
+/*
+ * SPI and I2C buses. Transfers take the time of the bits on the bus, the CPU waits
+ * for them like the blocking Arduino drivers do. I2C DMA transfers run in the background
+ * and end with the DMA interrupt.
+ */
+
+#define SIM_SPI_DEVICES 4
+#define SIM_I2C_DEVICES 8
+
+struct SimSpiSlot
+{
+    uint32_t nss_pin;
+    SimSpiDevice *dev;
+};
+
+struct SimI2cSlot
+{
+    uint8_t addr;
+    SimI2cDevice *dev;
+};
+
+static SimSpiSlot sim_spi[SIM_SPI_DEVICES];
+static int sim_spi_count = 0;
+static SimI2cSlot sim_i2c[SIM_I2C_DEVICES];
+static int sim_i2c_count = 0;
+
+SPIClass SPI;
+TwoWire Wire;
+
+static void sim_spi_nss(uint32_t pin, int level)
+{
+    for (int i = 0; i < sim_spi_count; i++)
+        if (sim_spi[i].nss_pin == pin)
+            sim_spi[i].dev->select(level == LOW);
+}
+
+/**
+ * @brief Connects a model to the SPI bus, selected by its NSS pin.
+ */
+void sim_spi_attach(uint32_t nss_pin, SimSpiDevice *dev)
+{
+    if (sim_spi_count == SIM_SPI_DEVICES)
+        return;
+    sim_spi[sim_spi_count++] = {nss_pin, dev};
+    sim_pin_watch(nss_pin, sim_spi_nss);
+}
+
+/**
+ * @brief Connects a model to the I2C bus at a 7-bit address.
+ */
+void sim_i2c_attach(uint8_t addr, SimI2cDevice *dev)
+{
+    if (sim_i2c_count < SIM_I2C_DEVICES)
+        sim_i2c[sim_i2c_count++] = {addr, dev};
+}
+
+static SimI2cDevice *sim_i2c_find(uint8_t addr)
+{
+    for (int i = 0; i < sim_i2c_count; i++)
+        if (sim_i2c[i].addr == addr)
+            return sim_i2c[i].dev;
+    return nullptr;
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+    uint8_t in = 0xFF;
+    for (int i = 0; i < sim_spi_count; i++)
+        if (digitalRead(sim_spi[i].nss_pin) == LOW)
+            in = sim_spi[i].dev->transfer(data);
+    sim_busy((8 * 1000000 + _clock - 1) / _clock);
+    return in;
+}
+
+void SPIClass::transfer(void *buf, size_t count)
+{
+    uint8_t *p = (uint8_t *)buf;
+    while (count--)
+    {
+        *p = transfer(*p);
+        p++;
+    }
+}
+
+/**
+ * @brief Waits for bytes on the bus: address, data and acknowledge bits.
+ */
+void TwoWire::bus_time(size_t bytes)
+{
+    sim_busy(((bytes + 1) * 9 + 2) * 1000000ULL / _clock);
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    _address = address;
+    _tx_len = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (_tx_len == BUFFER_LENGTH)
+        return 0;
+    _tx_buf[_tx_len++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+    size_t n = 0;
+    while (n < quantity && write(data[n]))
+        n++;
+    return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    SimI2cDevice *dev = sim_i2c_find(_address);
+    if (dev == nullptr)
+    {
+        bus_time(0);
+        return 2; // Address not acknowledged
+    }
+    bus_time(_tx_len);
+    dev->write(_tx_buf, _tx_len);
+    _tx_len = 0;
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop)
+{
+    (void)sendStop;
+    SimI2cDevice *dev = sim_i2c_find(address);
+    _rx_pos = 0;
+    _rx_len = 0;
+    if (dev == nullptr)
+    {
+        bus_time(0);
+        return 0;
+    }
+    bus_time(quantity);
+    _rx_len = dev->read(_rx_buf, quantity);
+    return _rx_len;
+}
+
+struct SimI2cDma
+{
+    I2C_HandleTypeDef *hi2c;
+    SimI2cDevice *dev;
+    const uint8_t *data;
+    uint16_t len;
+};
+
+static SimI2cDma sim_i2c_dma;
+
+/**
+ * @brief Ends an I2C DMA transfer: the device gets the data, the DMA interrupt fires.
+ */
+static void sim_i2c_dma_done(void *arg)
+{
+    (void)arg;
+    if (sim_i2c_dma.dev != nullptr)
+        sim_i2c_dma.dev->write(sim_i2c_dma.data, sim_i2c_dma.len);
+    sim_i2c_dma.hi2c->State = HAL_I2C_STATE_READY;
+    sim_nvic_raise(DMA1_Channel2_3_IRQn, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    hi2c->State = HAL_I2C_STATE_READY;
+    return HAL_OK;
+}
+
+/**
+ * @brief Disables the peripheral, a DMA transfer in progress never reaches the device.
+ */
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->State == HAL_I2C_STATE_BUSY_TX && sim_i2c_dma.hi2c == hi2c)
+        sim_cancel(sim_i2c_dma_done, nullptr);
+    hi2c->State = HAL_I2C_STATE_RESET;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    if (hi2c->State != HAL_I2C_STATE_READY || hi2c->hdmatx == nullptr)
+        return HAL_BUSY;
+
+    // An address that is not acknowledged ends the transfer after the address byte
+    SimI2cDevice *dev = sim_i2c_find(DevAddress >> 1);
+    size_t bytes = dev != nullptr ? Size : 0;
+    sim_i2c_dma = {hi2c, dev, pData, Size};
+    hi2c->State = HAL_I2C_STATE_BUSY_TX;
+    sim_at(sim_now() + ((bytes + 1) * 9 + 2) * 1000000ULL / hi2c->Init.Timing, sim_i2c_dma_done, nullptr);
+    return HAL_OK;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->State;
+}
+
+void HAL_I2CEx_EnableFastModePlus(uint32_t ConfigFastModePlus)
+{
+    (void)ConfigFastModePlus;
+}
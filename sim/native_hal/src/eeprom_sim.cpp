@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "stm32l0xx_hal.h"
+#include "sim.h"
+
+/*
+ * Data EEPROM, mapped at its MCU address so the firmware reads it through pointers.
+ * It is loaded from and saved to the --eeprom file, so a session saved by one run is
+ * restored by the next one.
+ */
+
+#define SIM_EEPROM_SIZE (DATA_EEPROM_BANK2_END + 1 - DATA_EEPROM_BASE)
+// Erase and write of one word
+#define SIM_EEPROM_WRITE_US 3200
+
+static uint8_t *sim_eeprom = nullptr;
+static bool sim_eeprom_unlocked = false;
+
+static void sim_eeprom_save(void)
+{
+    if (sim_opt.eeprom == nullptr)
+        return;
+    FILE *f = fopen(sim_opt.eeprom, "wb");
+    if (f == nullptr || fwrite(sim_eeprom, 1, SIM_EEPROM_SIZE, f) != SIM_EEPROM_SIZE)
+        fprintf(stderr, "sim: cannot save the EEPROM to %s\n", sim_opt.eeprom);
+    if (f != nullptr)
+        fclose(f);
+}
+
+/**
+ * @brief Maps the data EEPROM, erased or loaded from the --eeprom file.
+ */
+void sim_eeprom_init(void)
+{
+    void *p = mmap((void *)DATA_EEPROM_BASE, SIM_EEPROM_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void *)DATA_EEPROM_BASE)
+    {
+        fprintf(stderr, "sim: cannot map the data EEPROM at 0x%08lX\n", DATA_EEPROM_BASE);
+        exit(1);
+    }
+    sim_eeprom = (uint8_t *)p;
+
+    if (sim_opt.eeprom != nullptr)
+    {
+        FILE *f = fopen(sim_opt.eeprom, "rb");
+        if (f != nullptr)
+        {
+            if (fread(sim_eeprom, 1, SIM_EEPROM_SIZE, f) != SIM_EEPROM_SIZE)
+                memset(sim_eeprom, 0, SIM_EEPROM_SIZE);
+            fclose(f);
+        }
+    }
+    sim_on_exit(sim_eeprom_save);
+}
+
+static HAL_StatusTypeDef sim_eeprom_write(uint32_t Address, const void *data, size_t len)
+{
+    if (!sim_eeprom_unlocked || Address < DATA_EEPROM_BASE || Address + len > DATA_EEPROM_BANK2_END + 1)
+        return HAL_ERROR;
+    memcpy(sim_eeprom + (Address - DATA_EEPROM_BASE), data, len);
+    sim_busy(SIM_EEPROM_WRITE_US);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Unlock(void)
+{
+    sim_eeprom_unlocked = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Lock(void)
+{
+    sim_eeprom_unlocked = false;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Erase(uint32_t Address)
+{
+    uint32_t zero = 0;
+    return sim_eeprom_write(Address & ~3U, &zero, 4);
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Program(uint32_t TypeProgram, uint32_t Address, uint32_t Data)
+{
+    switch (TypeProgram)
+    {
+    case FLASH_TYPEPROGRAMDATA_BYTE:
+    {
+        uint8_t b = Data;
+        return sim_eeprom_write(Address, &b, 1);
+    }
+    case FLASH_TYPEPROGRAMDATA_HALFWORD:
+    {
+        uint16_t h = Data;
+        return sim_eeprom_write(Address, &h, 2);
+    }
+    default:
+        return sim_eeprom_write(Address, &Data, 4);
+    }
+}
@@ -0,0 +1,220 @@
+#include <Arduino.h>
+#include "sim.h"
+
+/*
+ * Sony CXD5603GF GPS receiver on USART4.
+ *
+ * The receiver answers the @ commands with "[CMD] Done", outputs a GGA sentence every
+ * position cycle once positioning is started (@GSR), without a fix until the time to
+ * first fix elapsed, and stops on @GSTP or @SLP. A reset pulse restarts it. The time to
+ * first fix is the hot one when the receiver had a fix in the last SIM_GPS_HOT_S.
+ */
+
+#define SIM_GPS_TX PC10 // MCU TX, receiver RX
+#define SIM_GPS_RX PC11 // MCU RX, receiver TX
+#define SIM_GPS_RST PB2
+#define SIM_GPS_EN PC6
+#define SIM_GPS_PWR PA3
+
+#define SIM_GPS_BOOT_US 300000
+#define SIM_GPS_ACK_US 10000
+#define SIM_GPS_HOT_S 7200
+#define SIM_GPS_LINE 96
+
+enum SimGpsState
+{
+    SIM_GPS_OFF,
+    SIM_GPS_BOOT,
+    SIM_GPS_IDLE,
+    SIM_GPS_POSITIONING,
+    SIM_GPS_SLEEP,
+};
+
+static SimGpsState sim_gps_state = SIM_GPS_OFF;
+static char sim_gps_line[SIM_GPS_LINE];
+static size_t sim_gps_line_len = 0;
+static char sim_gps_ack[SIM_GPS_LINE + 16];
+static uint32_t sim_gps_cycle_ms = 1000;
+static simtime_t sim_gps_fix_at;
+static simtime_t sim_gps_last_fix = 0;
+static bool sim_gps_had_fix = false;
+
+static bool sim_gps_powered(void)
+{
+    return sim_pin_level(SIM_GPS_PWR) && sim_pin_level(SIM_GPS_EN);
+}
+
+/**
+ * @brief Sends a line to the MCU, as one burst.
+ */
+static void sim_gps_send(const char *line)
+{
+    sim_uart_send(SIM_GPS_RX, (const uint8_t *)line, strlen(line));
+}
+
+static void sim_gps_booted(void *arg)
+{
+    (void)arg;
+    if (sim_gps_state == SIM_GPS_BOOT)
+        sim_gps_state = SIM_GPS_IDLE;
+}
+
+/**
+ * @brief Formats a coordinate as NMEA ddmm.mmmm or dddmm.mmmm.
+ */
+static void sim_gps_coord(char *buf, size_t len, double deg, int deg_digits)
+{
+    double a = fabs(deg);
+    int d = (int)a;
+    snprintf(buf, len, "%0*d%07.4f", deg_digits, d, (a - d) * 60);
+}
+
+/**
+ * @brief Outputs the GGA sentence of a position cycle.
+ */
+static void sim_gps_cycle(void *arg)
+{
+    (void)arg;
+    if (sim_gps_state != SIM_GPS_POSITIONING)
+        return;
+
+    char lat[32], lng[32], body[SIM_GPS_LINE], line[SIM_GPS_LINE + 8];
+    uint32_t s = (uint32_t)(sim_now() / 1000000) % 86400;
+    bool fix = sim_now() >= sim_gps_fix_at;
+    if (fix)
+    {
+        sim_gps_coord(lat, sizeof(lat), sim_opt.lat, 2);
+        sim_gps_coord(lng, sizeof(lng), sim_opt.lng, 3);
+        int len = snprintf(body, sizeof(body), "GPGGA,%02u%02u%02u.00,%s,%c,%s,%c,1,08,0.9,%.1f,M,0.0,M,,",
+                           (unsigned)(s / 3600), (unsigned)(s / 60 % 60), (unsigned)(s % 60), lat,
+                           sim_opt.lat < 0 ? 'S' : 'N', lng, sim_opt.lng < 0 ? 'W' : 'E', sim_opt.alt);
+        if (len < 0 || (size_t)len >= sizeof(body))
+        {
+            fprintf(stderr, "sim: the position does not fit in a GGA sentence\n");
+            exit(1);
+        }
+        sim_gps_last_fix = sim_now();
+        sim_gps_had_fix = true;
+    }
+    else
+    {
+        snprintf(body, sizeof(body), "GPGGA,%02u%02u%02u.00,,,,,0,00,99.9,,,,,,",
+                 (unsigned)(s / 3600), (unsigned)(s / 60 % 60), (unsigned)(s % 60));
+    }
+
+    uint8_t cs = 0;
+    for (const char *p = body; *p; p++)
+        cs ^= *p;
+    snprintf(line, sizeof(line), "$%s*%02X\r\n", body, cs);
+    sim_gps_send(line);
+    sim_at(sim_now() + (simtime_t)sim_gps_cycle_ms * 1000, sim_gps_cycle, nullptr);
+}
+
+static void sim_gps_send_ack(void *arg)
+{
+    (void)arg;
+    if (sim_gps_state != SIM_GPS_OFF && sim_gps_state != SIM_GPS_BOOT)
+        sim_gps_send(sim_gps_ack);
+}
+
+/**
+ * @brief Runs a command received from the MCU.
+ */
+static void sim_gps_command(char *line)
+{
+    if (line[0] != '@' || sim_gps_state == SIM_GPS_OFF || sim_gps_state == SIM_GPS_BOOT ||
+        sim_gps_state == SIM_GPS_SLEEP)
+        return;
+
+    char *arg = strchr(line, ' ');
+    if (arg != nullptr)
+        *arg++ = '\0';
+
+    if (strcmp(line, "@GSR") == 0 || strcmp(line, "@GCD") == 0 || strcmp(line, "@GSW") == 0)
+    {
+        if (sim_gps_state != SIM_GPS_POSITIONING)
+        {
+            bool hot = sim_gps_had_fix && sim_now() - sim_gps_last_fix < SIM_GPS_HOT_S * 1000000ULL;
+            double ttff = hot ? sim_opt.ttff_hot_s : sim_opt.ttff_cold_s;
+            sim_gps_fix_at = sim_now() + (simtime_t)(ttff * 1e6);
+            sim_gps_state = SIM_GPS_POSITIONING;
+            sim_cancel(sim_gps_cycle, nullptr);
+            sim_at(sim_now() + (simtime_t)sim_gps_cycle_ms * 1000, sim_gps_cycle, nullptr);
+        }
+    }
+    else if (strcmp(line, "@GSTP") == 0)
+    {
+        sim_gps_state = SIM_GPS_IDLE;
+        sim_cancel(sim_gps_cycle, nullptr);
+    }
+    else if (strcmp(line, "@GSOP") == 0 && arg != nullptr)
+    {
+        unsigned mode, cycle;
+        if (sscanf(arg, "%u %u", &mode, &cycle) == 2 && cycle >= 1000)
+            sim_gps_cycle_ms = cycle;
+    }
+
+    // The acknowledge of @SLP is sent before the receiver sleeps
+    snprintf(sim_gps_ack, sizeof(sim_gps_ack), "[%s] Done\r\n", line + 1);
+    sim_cancel(sim_gps_send_ack, nullptr);
+    sim_at(sim_now() + SIM_GPS_ACK_US, sim_gps_send_ack, nullptr);
+    if (strcmp(line, "@SLP") == 0)
+    {
+        sim_gps_state = SIM_GPS_SLEEP;
+        sim_cancel(sim_gps_cycle, nullptr);
+    }
+}
+
+/**
+ * @brief Receives the characters sent by the MCU.
+ */
+static void sim_gps_rx(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = data[i];
+        if (c == '\n')
+        {
+            sim_gps_line[sim_gps_line_len] = '\0';
+            sim_gps_line_len = 0;
+            sim_gps_command(sim_gps_line);
+        }
+        else if (c != '\r' && sim_gps_line_len < SIM_GPS_LINE - 1)
+        {
+            sim_gps_line[sim_gps_line_len++] = c;
+        }
+    }
+}
+
+/**
+ * @brief Follows the power and reset lines.
+ */
+static void sim_gps_pins(uint32_t pin, int level)
+{
+    (void)level;
+    bool run = sim_gps_powered() && sim_pin_level(SIM_GPS_RST);
+    if (!run)
+    {
+        if (!sim_gps_powered())
+            sim_gps_had_fix = false;
+        sim_gps_state = SIM_GPS_OFF;
+        sim_cancel(sim_gps_cycle, nullptr);
+        sim_cancel(sim_gps_booted, nullptr);
+    }
+    else if (sim_gps_state == SIM_GPS_OFF || (pin == SIM_GPS_RST && sim_gps_state == SIM_GPS_SLEEP))
+    {
+        sim_gps_state = SIM_GPS_BOOT;
+        sim_at(sim_now() + SIM_GPS_BOOT_US, sim_gps_booted, nullptr);
+    }
+}
+
+/**
+ * @brief Connects the receiver to the board.
+ */
+void sim_gps_init(void)
+{
+    sim_uart_attach(SIM_GPS_TX, sim_gps_rx);
+    sim_pin_watch(SIM_GPS_RST, sim_gps_pins);
+    sim_pin_watch(SIM_GPS_EN, sim_gps_pins);
+    sim_pin_watch(SIM_GPS_PWR, sim_gps_pins);
+}
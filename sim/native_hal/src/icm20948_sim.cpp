@@ -0,0 +1,267 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+/*
+ * ICM-20948 IMU on the I2C bus, as driven by the SparkFun library, and the motion of
+ * the board.
+ *
+ * The register file has the four user banks, selected with REG_BANK_SEL. A write sets
+ * the register address and auto-increments from there, a read goes on from the last
+ * address. The I2C master is only modelled for the peripheral 4 single byte
+ * transactions, to the WIA and CNTL registers of the AK09916 magnetometer. The
+ * wake-on-motion status is latched while the board moves with WOM enabled, and cleared
+ * by reading INT_STATUS. The IMU is powered from the 1.8 V rail and loses its settings
+ * when the rail is cut.
+ */
+
+#define SIM_IMU_ADDR 0x69
+#define SIM_IMU_PWR PB0 // PWR_1_8V_PIN
+#define SIM_IMU_MOTIONS 32
+
+// Bank 0
+#define SIM_IMU_WHO_AM_I 0x00
+#define SIM_IMU_LP_CONFIG 0x05
+#define SIM_IMU_PWR_MGMT_1 0x06
+#define SIM_IMU_PWR_MGMT_2 0x07
+#define SIM_IMU_INT_ENABLE 0x10
+#define SIM_IMU_I2C_MST_STATUS 0x17
+#define SIM_IMU_INT_STATUS 0x19
+// Bank 2
+#define SIM_IMU_ACCEL_SMPLRT_DIV_1 0x10
+#define SIM_IMU_ACCEL_SMPLRT_DIV_2 0x11
+#define SIM_IMU_ACCEL_INTEL_CTRL 0x12
+#define SIM_IMU_ACCEL_WOM_THR 0x13
+// Bank 3
+#define SIM_IMU_PERIPH4_ADDR 0x13
+#define SIM_IMU_PERIPH4_REG 0x14
+#define SIM_IMU_PERIPH4_CTRL 0x15
+#define SIM_IMU_PERIPH4_DO 0x16
+#define SIM_IMU_PERIPH4_DI 0x17
+#define SIM_IMU_BANK_SEL 0x7F
+
+#define SIM_MAG_ADDR 0x0C
+#define SIM_MAG_CNTL3 0x32
+
+struct SimMotion
+{
+    simtime_t at;
+    simtime_t len;
+};
+
+class SimImu : public SimI2cDevice
+{
+public:
+    void write(const uint8_t *data, size_t len) override;
+    size_t read(uint8_t *data, size_t len) override;
+    void reset(void);
+    void power(bool on);
+    void move(bool moving);
+    void report(void);
+
+private:
+    bool wom_enabled(void);
+    void store(uint8_t reg, uint8_t value);
+    void periph4(void);
+
+    uint8_t _regs[4][128];
+    uint8_t _mag[64];
+    uint8_t _bank = 0;
+    uint8_t _addr = 0;
+    bool _powered = false;
+    bool _moving = false;
+    bool _wom = false; // WOM_INT latched
+    uint32_t _status_reads = 0;
+    uint32_t _wom_reads = 0;
+};
+
+static SimImu sim_imu;
+static SimMotion sim_motions[SIM_IMU_MOTIONS];
+static int sim_motion_count = 0;
+
+/**
+ * @brief Sets the registers to their power on values.
+ */
+void SimImu::reset(void)
+{
+    memset(_regs, 0, sizeof(_regs));
+    memset(_mag, 0, sizeof(_mag));
+    _regs[0][SIM_IMU_WHO_AM_I] = 0xEA;
+    _regs[0][SIM_IMU_LP_CONFIG] = 0x40;
+    _regs[0][SIM_IMU_PWR_MGMT_1] = 0x41; // Sleep, auto clock
+    _mag[0x00] = 0x48;                   // WIA1
+    _mag[0x01] = 0x09;                   // WIA2
+    _bank = 0;
+    _wom = false;
+}
+
+void SimImu::power(bool on)
+{
+    if (!on)
+        reset();
+    _powered = on;
+}
+
+/**
+ * @brief Returns true if a motion sets WOM_INT: accelerometer running, WOM logic and
+ * interrupt enabled.
+ */
+bool SimImu::wom_enabled(void)
+{
+    return _powered && !(_regs[0][SIM_IMU_PWR_MGMT_1] & 0x40) &&
+           (_regs[0][SIM_IMU_PWR_MGMT_2] & 0x38) != 0x38 && (_regs[0][SIM_IMU_INT_ENABLE] & 0x08) &&
+           (_regs[2][SIM_IMU_ACCEL_INTEL_CTRL] & 0x02);
+}
+
+void SimImu::move(bool moving)
+{
+    _moving = moving;
+    if (moving && wom_enabled())
+        _wom = true;
+}
+
+/**
+ * @brief Runs a single byte transaction of the I2C master peripheral 4.
+ */
+void SimImu::periph4(void)
+{
+    uint8_t addr = _regs[3][SIM_IMU_PERIPH4_ADDR];
+    uint8_t reg = _regs[3][SIM_IMU_PERIPH4_REG] % sizeof(_mag);
+
+    _regs[3][SIM_IMU_PERIPH4_CTRL] &= ~0x80;
+    if ((addr & 0x7F) != SIM_MAG_ADDR)
+    {
+        _regs[0][SIM_IMU_I2C_MST_STATUS] |= 0x50; // PERIPH4_DONE, PERIPH4_NACK
+        return;
+    }
+    if (addr & 0x80)
+        _regs[3][SIM_IMU_PERIPH4_DI] = _mag[reg];
+    else if (reg == SIM_MAG_CNTL3 && (_regs[3][SIM_IMU_PERIPH4_DO] & 0x01))
+        memset(_mag + 0x02, 0, sizeof(_mag) - 0x02); // Soft reset
+    else
+        _mag[reg] = _regs[3][SIM_IMU_PERIPH4_DO];
+    _regs[0][SIM_IMU_I2C_MST_STATUS] |= 0x40; // PERIPH4_DONE
+}
+
+void SimImu::store(uint8_t reg, uint8_t value)
+{
+    if (reg == SIM_IMU_BANK_SEL)
+    {
+        _bank = (value >> 4) & 0x03;
+        return;
+    }
+    if (_bank == 0 && reg == SIM_IMU_WHO_AM_I)
+        return;
+    if (_bank == 0 && reg == SIM_IMU_PWR_MGMT_1 && (value & 0x80))
+    {
+        reset();
+        return;
+    }
+    _regs[_bank][reg & 0x7F] = value;
+    if (_bank == 3 && reg == SIM_IMU_PERIPH4_CTRL && (value & 0x80))
+        periph4();
+}
+
+void SimImu::write(const uint8_t *data, size_t len)
+{
+    if (!_powered || len == 0)
+        return;
+    _addr = data[0];
+    for (size_t i = 1; i < len; i++)
+        store(_addr++, data[i]);
+}
+
+size_t SimImu::read(uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t reg = _addr++ & 0x7F;
+        if (!_powered)
+        {
+            data[i] = 0;
+            continue;
+        }
+        data[i] = reg == SIM_IMU_BANK_SEL ? _bank << 4 : _regs[_bank][reg];
+        if (_bank == 0 && reg == SIM_IMU_I2C_MST_STATUS)
+        {
+            _regs[0][reg] = 0;
+        }
+        else if (_bank == 0 && reg == SIM_IMU_INT_STATUS)
+        {
+            // Latched by a motion, set again while the board keeps moving
+            if (_wom || (_moving && wom_enabled()))
+                data[i] |= 0x08;
+            _wom = false;
+            _status_reads++;
+            if (data[i] & 0x08)
+                _wom_reads++;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Prints the wake-on-motion configuration and the status reads.
+ */
+void SimImu::report(void)
+{
+    unsigned div = (_regs[2][SIM_IMU_ACCEL_SMPLRT_DIV_1] & 0x0F) << 8 | _regs[2][SIM_IMU_ACCEL_SMPLRT_DIV_2];
+    fprintf(stderr, "\nICM-20948: wake-on-motion %s, threshold %u mg, accel %.1f Hz%s%s, %u status reads, %u with motion\n",
+            wom_enabled() ? "on" : "off", _regs[2][SIM_IMU_ACCEL_WOM_THR] * 4, 1125.0 / (1 + div),
+            (_regs[0][SIM_IMU_PWR_MGMT_1] & 0x20) ? " low power" : "",
+            (_regs[0][SIM_IMU_PWR_MGMT_2] & 0x07) == 0x07 ? ", gyro off" : "", _status_reads, _wom_reads);
+}
+
+static void sim_imu_pin(uint32_t pin, int level)
+{
+    (void)pin;
+    sim_imu.power(level == HIGH);
+}
+
+static void sim_imu_stop(void *arg)
+{
+    (void)arg;
+    sim_log("board still");
+    sim_imu.move(false);
+}
+
+static void sim_imu_start(void *arg)
+{
+    SimMotion *motion = (SimMotion *)arg;
+    sim_log("board moving for %.0f s", motion->len / 1e6);
+    sim_imu.move(true);
+    sim_at(sim_now() + motion->len, sim_imu_stop, nullptr);
+}
+
+static void sim_imu_report(void)
+{
+    sim_imu.report();
+}
+
+/**
+ * @brief Schedules a motion of the board.
+ *
+ * @param at_s Start of the motion in seconds.
+ * @param len_s Duration of the motion in seconds.
+ */
+void sim_imu_move(double at_s, double len_s)
+{
+    if (sim_motion_count == SIM_IMU_MOTIONS)
+        return;
+    SimMotion *motion = &sim_motions[sim_motion_count++];
+    motion->at = (simtime_t)(at_s * 1e6);
+    motion->len = (simtime_t)(len_s * 1e6);
+    sim_at(motion->at, sim_imu_start, motion);
+}
+
+/**
+ * @brief Connects the IMU to the I2C bus and to the 1.8 V rail.
+ */
+void sim_imu_init(void)
+{
+    sim_imu.reset();
+    sim_i2c_attach(SIM_IMU_ADDR, &sim_imu);
+    sim_pin_watch(SIM_IMU_PWR, sim_imu_pin);
+    sim_on_exit(sim_imu_report);
+}
@@ -0,0 +1,458 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "sim.h"
+
+/*
+ * Virtual clock, hardware event queue and interrupt delivery.
+ */
+
+// CPU time charged for every loop() and every time query, in microseconds
+#define SIM_LOOP_US 20
+#define SIM_EVENTS_MAX 64
+#define SIM_IRQS_MAX 16
+#define SIM_EXIT_HOOKS 8
+#define SIM_FOREVER UINT64_MAX
+
+struct SimEvent
+{
+    simtime_t t;
+    SimEventFn fn;
+    void *arg;
+};
+
+struct SimIrq
+{
+    SimIrqFn handler;
+    bool wakes_stop;
+};
+
+SimOptions sim_opt = {
+    .duration_s = 3600,
+    .eeprom = nullptr,
+    .quiet = false,
+    .battery_v = 3.9,
+    .lat = 40.416775,
+    .lng = -3.703790,
+    .alt = 650,
+    .ttff_cold_s = 32,
+    .ttff_hot_s = 2,
+    .seed = 1,
+};
+
+static simtime_t sim_time = 0;
+static simtime_t sim_end = SIM_FOREVER;
+static simtime_t sim_mode_time[SIM_POWER_MODES];
+static uint32_t sim_wakeups = 0;
+// SysTick time lost while suspended, and the SysTick time of the suspension
+static simtime_t sim_tick_lost = 0;
+static simtime_t sim_tick_suspended_at = 0;
+static bool sim_tick_suspended = false;
+static SimEvent sim_events[SIM_EVENTS_MAX];
+static int sim_event_count = 0;
+static SimIrq sim_irqs[SIM_IRQS_MAX];
+static int sim_irq_count = 0;
+static bool sim_irq_on = true;
+static bool sim_in_irq = false;
+static bool sim_woken = false;
+static SimPowerMode sim_mode = SIM_RUN;
+static void (*sim_exit_hooks[SIM_EXIT_HOOKS])(void);
+static int sim_exit_count = 0;
+
+extern void setup(void);
+extern void loop(void);
+
+/**
+ * @brief Prints the time spent in each power mode and ends the simulation.
+ */
+static void sim_finish(void)
+{
+    static const char *const names[SIM_POWER_MODES] = {"run", "sleep", "stop"};
+
+    for (int i = sim_exit_count - 1; i >= 0; i--)
+        sim_exit_hooks[i]();
+
+    fprintf(stderr, "\nSimulated %.3f s, %lu wake ups\n", sim_time / 1e6, (unsigned long)sim_wakeups);
+    for (int m = 0; m < SIM_POWER_MODES; m++)
+        fprintf(stderr, "  %-6s %12.3f s %8.3f %%\n", names[m], sim_mode_time[m] / 1e6,
+                sim_time ? 100.0 * sim_mode_time[m] / sim_time : 0.0);
+    fflush(stdout);
+    exit(0);
+}
+
+/**
+ * @brief Delivers the pending interrupts, unless they are masked.
+ */
+static void sim_dispatch(void)
+{
+    if (!sim_irq_on || sim_in_irq)
+        return;
+
+    while (sim_irq_count)
+    {
+        SimIrqFn handler = sim_irqs[0].handler;
+        memmove(&sim_irqs[0], &sim_irqs[1], --sim_irq_count * sizeof(SimIrq));
+        sim_in_irq = true;
+        handler();
+        sim_in_irq = false;
+    }
+}
+
+/**
+ * @brief Moves the clock forward, running the hardware events on the way.
+ *
+ * While the core runs, the interrupts an event raises are delivered right after it, so
+ * a long busy period sees them at the right time and in order.
+ *
+ * @param mode Power mode the time is spent in.
+ * @param t Time to move to.
+ */
+static void sim_advance(SimPowerMode mode, simtime_t t)
+{
+    SimPowerMode prev = sim_mode;
+    sim_mode = mode;
+    if (t > sim_end)
+        t = sim_end;
+
+    while (sim_event_count && sim_events[0].t <= t)
+    {
+        SimEvent ev = sim_events[0];
+        memmove(&sim_events[0], &sim_events[1], --sim_event_count * sizeof(SimEvent));
+        if (ev.t > sim_time)
+        {
+            sim_mode_time[mode] += ev.t - sim_time;
+            sim_time = ev.t;
+        }
+        ev.fn(ev.arg);
+        if (mode == SIM_RUN)
+            sim_dispatch();
+    }
+    if (t > sim_time)
+    {
+        sim_mode_time[mode] += t - sim_time;
+        sim_time = t;
+    }
+    sim_mode = prev;
+
+    if (sim_time >= sim_end)
+        sim_finish();
+    if (mode == SIM_RUN)
+        sim_dispatch();
+}
+
+/**
+ * @brief Returns the virtual time.
+ *
+ * @return Microseconds since power on.
+ */
+simtime_t sim_now(void)
+{
+    return sim_time;
+}
+
+/**
+ * @brief Returns the SysTick time, which does not count in STOP mode or while suspended.
+ *
+ * @return Microseconds counted by SysTick since power on.
+ */
+simtime_t sim_systick(void)
+{
+    sim_busy(1);
+    if (sim_tick_suspended)
+        return sim_tick_suspended_at - sim_tick_lost;
+    return sim_time - sim_mode_time[SIM_STOP] - sim_tick_lost;
+}
+
+/**
+ * @brief Stops or restarts the SysTick count, like HAL_SuspendTick() and HAL_ResumeTick().
+ *
+ * @param suspend true to stop the count.
+ */
+void sim_systick_suspend(bool suspend)
+{
+    simtime_t now = sim_time - sim_mode_time[SIM_STOP];
+
+    if (suspend == sim_tick_suspended)
+        return;
+    if (suspend)
+        sim_tick_suspended_at = now;
+    else
+        sim_tick_lost += now - sim_tick_suspended_at;
+    sim_tick_suspended = suspend;
+}
+
+/**
+ * @brief Keeps the CPU running for a while.
+ *
+ * @param us Duration in microseconds.
+ */
+void sim_busy(simtime_t us)
+{
+    sim_advance(SIM_RUN, sim_time + us);
+}
+
+/**
+ * @brief Idles the MCU until an interrupt wakes it up.
+ *
+ * Like WFI, a masked interrupt also ends the idle period, it is delivered once
+ * interrupts are enabled again.
+ *
+ * @param mode SIM_SLEEP or SIM_STOP.
+ * @param max_us Maximum idle time in microseconds, or 0 to wait for an interrupt.
+ */
+void sim_idle(SimPowerMode mode, simtime_t max_us)
+{
+    simtime_t until = max_us ? sim_time + max_us : SIM_FOREVER;
+
+    sim_wakeups++;
+    sim_woken = false;
+    for (int i = 0; i < sim_irq_count; i++)
+        if (mode != SIM_STOP || sim_irqs[i].wakes_stop)
+            return;
+
+    sim_mode = mode;
+    while (!sim_woken)
+    {
+        if (sim_event_count == 0 && until == SIM_FOREVER)
+        {
+            fprintf(stderr, "sim: the MCU sleeps with no wake up source\n");
+            sim_finish();
+        }
+        simtime_t t = sim_event_count ? sim_events[0].t : until;
+        if (t >= until)
+        {
+            sim_advance(mode, until);
+            break;
+        }
+        sim_advance(mode, t);
+    }
+    sim_mode = SIM_RUN;
+    sim_dispatch();
+}
+
+/**
+ * @brief Returns the time spent in a power mode.
+ */
+simtime_t sim_power_time(SimPowerMode mode)
+{
+    return sim_mode_time[mode];
+}
+
+/**
+ * @brief Schedules a hardware event.
+ *
+ * @param t Time of the event, a time in the past runs it on the next clock move.
+ * @param fn Function called at that time.
+ * @param arg Argument passed to fn.
+ */
+void sim_at(simtime_t t, SimEventFn fn, void *arg)
+{
+    if (sim_event_count == SIM_EVENTS_MAX)
+    {
+        fprintf(stderr, "sim: event queue full\n");
+        abort();
+    }
+
+    int i = sim_event_count;
+    while (i > 0 && sim_events[i - 1].t > t)
+    {
+        sim_events[i] = sim_events[i - 1];
+        i--;
+    }
+    sim_events[i] = {t, fn, arg};
+    sim_event_count++;
+}
+
+/**
+ * @brief Cancels the scheduled events matching a function and argument.
+ */
+void sim_cancel(SimEventFn fn, void *arg)
+{
+    int j = 0;
+    for (int i = 0; i < sim_event_count; i++)
+        if (sim_events[i].fn != fn || sim_events[i].arg != arg)
+            sim_events[j++] = sim_events[i];
+    sim_event_count = j;
+}
+
+/**
+ * @brief Raises an interrupt.
+ *
+ * @param handler The interrupt handler, pending only once.
+ * @param wakes_stop true if the interrupt is an EXTI line, which wakes from STOP mode.
+ */
+void sim_irq(SimIrqFn handler, bool wakes_stop)
+{
+    if (handler == nullptr)
+        return;
+    if (sim_mode != SIM_STOP || wakes_stop)
+        sim_woken = true;
+
+    for (int i = 0; i < sim_irq_count; i++)
+        if (sim_irqs[i].handler == handler)
+            return;
+    if (sim_irq_count < SIM_IRQS_MAX)
+        sim_irqs[sim_irq_count++] = {handler, wakes_stop};
+}
+
+/**
+ * @brief Masks or unmasks the interrupts (PRIMASK).
+ */
+void sim_irq_enable(bool enable)
+{
+    sim_irq_on = enable;
+    if (enable && sim_mode == SIM_RUN)
+        sim_dispatch();
+}
+
+/**
+ * @brief Tells whether the interrupts are unmasked.
+ */
+bool sim_irq_enabled(void)
+{
+    return sim_irq_on;
+}
+
+/**
+ * @brief Registers a function called when the simulation ends, before the report.
+ */
+void sim_on_exit(void (*fn)(void))
+{
+    if (sim_exit_count < SIM_EXIT_HOOKS)
+        sim_exit_hooks[sim_exit_count++] = fn;
+}
+
+/**
+ * @brief Prints a line from a model among the serial output, stamped with the virtual time.
+ */
+void sim_log(const char *format, ...)
+{
+    va_list ap;
+
+    if (sim_opt.quiet)
+        return;
+    printf("[%11.6f] sim: ", sim_time / 1e6);
+    va_start(ap, format);
+    vprintf(format, ap);
+    va_end(ap);
+    putchar('\n');
+}
+
+// pio test links the main() of the test instead, with no model started
+#ifndef PIO_UNIT_TESTING
+static void sim_usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -d, --duration S      simulated time in seconds (%.0f)\n"
+            "  -e, --eeprom FILE     keep the data EEPROM in FILE across runs\n"
+            "  -q, --quiet           do not print the firmware serial output\n"
+            "  -b, --battery V       battery voltage (%.2f)\n"
+            "  -p, --position LAT,LNG,ALT  position reported by the GPS\n"
+            "  -t, --ttff COLD,HOT   GPS time to first fix in seconds (%.0f,%.0f)\n"
+            "  -T, --touch S[:MS]    press the touch pad at S seconds for MS ms (100)\n"
+            "  -m, --motion S[:DUR]  move the board at S seconds for DUR s (60)\n"
+            "  -D, --downlink S:HEX[:RSSI:SNR]  receive the PHY payload HEX in the first\n"
+            "                        receive window after S seconds (-60 dBm, 8 dB)\n"
+            "  -s, --seed N          seed of the models randomness (%u)\n",
+            prog, sim_opt.duration_s, sim_opt.battery_v, sim_opt.ttff_cold_s, sim_opt.ttff_hot_s,
+            (unsigned)sim_opt.seed);
+    exit(2);
+}
+
+void sim_touch_press(double at_s, double ms);
+void sim_imu_move(double at_s, double len_s);
+bool sim_radio_downlink(double at_s, const char *hex, int rssi, double snr);
+
+/**
+ * @brief Runs the firmware on the simulated board.
+ */
+int main(int argc, char **argv)
+{
+    static const struct option options[] = {
+        {"duration", required_argument, nullptr, 'd'},
+        {"eeprom", required_argument, nullptr, 'e'},
+        {"quiet", no_argument, nullptr, 'q'},
+        {"battery", required_argument, nullptr, 'b'},
+        {"position", required_argument, nullptr, 'p'},
+        {"ttff", required_argument, nullptr, 't'},
+        {"touch", required_argument, nullptr, 'T'},
+        {"motion", required_argument, nullptr, 'm'},
+        {"downlink", required_argument, nullptr, 'D'},
+        {"seed", required_argument, nullptr, 's'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int c, rssi;
+    double at, ms, len, snr;
+    char hex[2 * 255 + 1];
+
+    while ((c = getopt_long(argc, argv, "d:e:qb:p:t:T:m:D:s:h", options, nullptr)) != -1)
+    {
+        switch (c)
+        {
+        case 'd':
+            sim_opt.duration_s = atof(optarg);
+            break;
+        case 'e':
+            sim_opt.eeprom = optarg;
+            break;
+        case 'q':
+            sim_opt.quiet = true;
+            break;
+        case 'b':
+            sim_opt.battery_v = atof(optarg);
+            break;
+        case 'p':
+            if (sscanf(optarg, "%lf,%lf,%lf", &sim_opt.lat, &sim_opt.lng, &sim_opt.alt) != 3)
+                sim_usage(argv[0]);
+            break;
+        case 't':
+            if (sscanf(optarg, "%lf,%lf", &sim_opt.ttff_cold_s, &sim_opt.ttff_hot_s) != 2)
+                sim_usage(argv[0]);
+            break;
+        case 'T':
+            ms = 100;
+            if (sscanf(optarg, "%lf:%lf", &at, &ms) < 1)
+                sim_usage(argv[0]);
+            sim_touch_press(at, ms);
+            break;
+        case 'm':
+            len = 60;
+            if (sscanf(optarg, "%lf:%lf", &at, &len) < 1)
+                sim_usage(argv[0]);
+            sim_imu_move(at, len);
+            break;
+        case 'D':
+            rssi = -60;
+            snr = 8;
+            if (sscanf(optarg, "%lf:%510[0-9a-fA-F]:%d:%lf", &at, hex, &rssi, &snr) < 2 ||
+                !sim_radio_downlink(at, hex, rssi, snr))
+                sim_usage(argv[0]);
+            break;
+        case 's':
+            sim_opt.seed = strtoul(optarg, nullptr, 0);
+            break;
+        default:
+            sim_usage(argv[0]);
+        }
+    }
+    sim_end = (simtime_t)(sim_opt.duration_s * 1e6);
+
+    sim_eeprom_init();
+    sim_board_init();
+    sim_gps_init();
+    sim_radio_init();
+    sim_oled_init();
+    sim_imu_init();
+
+    setup();
+    for (;;)
+    {
+        loop();
+        sim_busy(SIM_LOOP_US);
+    }
+}
+#endif
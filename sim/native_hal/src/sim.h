@@ -0,0 +1,97 @@
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Discrete-event model of the T-Impulse board for the native build.
+ *
+ * The firmware runs unchanged on top of stand-ins for the Arduino core, the STM32 HAL
+ * and the STM32 libraries. They all share one virtual clock, in microseconds since power
+ * on. The clock only moves when the firmware spends time: a fixed cost per loop() and
+ * per time query, delay(), bus transfers, EEPROM writes, and the sleep modes, which
+ * jump straight to the next hardware event. Hardware models (GPS, radio, touch pad,
+ * timers) schedule events on the clock and raise interrupts; interrupts are delivered
+ * while they are not masked, like on the MCU.
+ */
+
+typedef uint64_t simtime_t;
+typedef void (*SimEventFn)(void *arg);
+typedef void (*SimIrqFn)(void);
+
+enum SimPowerMode
+{
+    SIM_RUN,   // Core running
+    SIM_SLEEP, // Core stopped, peripherals and SysTick running
+    SIM_STOP,  // STOP mode, only EXTI lines (pins, LPTIM1, RTC) wake the MCU up
+    SIM_POWER_MODES,
+};
+
+struct SimOptions
+{
+    double duration_s;    // Simulated time before exiting
+    const char *eeprom;   // File holding the data EEPROM across runs, or nullptr
+    bool quiet;           // Do not print the firmware serial output
+    double battery_v;     // Battery voltage
+    double lat, lng, alt; // Position reported by the GPS
+    double ttff_cold_s;   // GPS time to first fix without a recent fix
+    double ttff_hot_s;    // GPS time to first fix with a recent fix
+    uint32_t seed;        // Seed of the models randomness
+};
+
+extern SimOptions sim_opt;
+
+// Virtual clock
+simtime_t sim_now(void);
+simtime_t sim_systick(void);
+void sim_systick_suspend(bool suspend);
+void sim_busy(simtime_t us);
+void sim_idle(SimPowerMode mode, simtime_t max_us);
+simtime_t sim_power_time(SimPowerMode mode);
+
+// Hardware events and interrupts
+void sim_at(simtime_t t, SimEventFn fn, void *arg);
+void sim_cancel(SimEventFn fn, void *arg);
+void sim_irq(SimIrqFn handler, bool wakes_stop);
+void sim_irq_enable(bool enable);
+bool sim_irq_enabled(void);
+void sim_on_exit(void (*fn)(void));
+void sim_log(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Pins, driven from outside by the models
+void sim_pin_drive(uint32_t pin, int level);
+int sim_pin_level(uint32_t pin);
+void sim_pin_watch(uint32_t pin, void (*fn)(uint32_t pin, int level));
+
+// Serial ports, seen from the device at the other end
+void sim_uart_attach(uint32_t tx_pin, void (*fn)(const uint8_t *data, size_t len));
+void sim_uart_send(uint32_t rx_pin, const uint8_t *data, size_t len);
+
+// SPI and I2C devices
+class SimSpiDevice
+{
+public:
+    virtual void select(bool selected) = 0;
+    virtual uint8_t transfer(uint8_t out) = 0;
+};
+
+class SimI2cDevice
+{
+public:
+    virtual void write(const uint8_t *data, size_t len) = 0;
+    virtual size_t read(uint8_t *data, size_t len) = 0;
+};
+
+void sim_spi_attach(uint32_t nss_pin, SimSpiDevice *dev);
+void sim_i2c_attach(uint8_t addr, SimI2cDevice *dev);
+
+// Models, started from main() before setup()
+void sim_board_init(void);
+void sim_gps_init(void);
+void sim_radio_init(void);
+void sim_oled_init(void);
+void sim_imu_init(void);
+void sim_eeprom_init(void);
+
+#endif /* __SIM_H__ */
@@ -0,0 +1,160 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+/*
+ * SSD1306 OLED controller on the I2C bus, as driven by U8x8.
+ *
+ * Each transfer starts with a control byte: commands (Co = 0, D/C# = 0) or display RAM
+ * data (D/C# = 1). Only page addressing is modelled, which is what U8x8 uses. The model
+ * counts the traffic and the time the panel is on, and shows the last screen on exit.
+ */
+
+#define SIM_OLED_ADDR 0x3C
+#define SIM_OLED_PAGES 8
+#define SIM_OLED_COLUMNS 128
+// Visible part of the display RAM on the 64x32 panel
+#define SIM_OLED_X 32
+#define SIM_OLED_W 64
+#define SIM_OLED_H_PAGES 4
+
+class SimOled : public SimI2cDevice
+{
+public:
+    void write(const uint8_t *data, size_t len) override;
+    size_t read(uint8_t *data, size_t len) override
+    {
+        memset(data, 0, len);
+        return len;
+    }
+    void report(void);
+
+private:
+    void command(uint8_t byte);
+    void power(bool on);
+
+    uint8_t _ram[SIM_OLED_PAGES][SIM_OLED_COLUMNS] = {};
+    uint8_t _page = 0;
+    uint8_t _column = 0;
+    uint8_t _args_left = 0; // Arguments of the last command still to come
+    bool _on = false;
+    simtime_t _on_since = 0;
+    simtime_t _on_time = 0;
+    uint32_t _transfers = 0;
+    uint32_t _bytes = 0;
+    uint32_t _data_bytes = 0;
+};
+
+static SimOled sim_oled;
+
+/**
+ * @brief Returns the number of arguments of a command.
+ */
+static uint8_t sim_oled_args(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case 0x81: // Contrast
+    case 0x8D: // Charge pump
+    case 0xA8: // Multiplex ratio
+    case 0xD3: // Display offset
+    case 0xD5: // Clock divide
+    case 0xD9: // Precharge
+    case 0xDA: // COM pins
+    case 0xDB: // VCOMH
+    case 0x20: // Addressing mode
+        return 1;
+    case 0x21: // Column range
+    case 0x22: // Page range
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+void SimOled::power(bool on)
+{
+    if (on && !_on)
+        _on_since = sim_now();
+    else if (!on && _on)
+        _on_time += sim_now() - _on_since;
+    _on = on;
+}
+
+void SimOled::command(uint8_t byte)
+{
+    if (_args_left)
+    {
+        _args_left--;
+        return;
+    }
+    _args_left = sim_oled_args(byte);
+    if (byte == 0xAE || byte == 0xAF)
+        power(byte == 0xAF);
+    else if ((byte & 0xF8) == 0xB0)
+        _page = byte & 0x07;
+    else if ((byte & 0xF0) == 0x00)
+        _column = (_column & 0xF0) | byte;
+    else if ((byte & 0xF0) == 0x10)
+        _column = (_column & 0x0F) | (byte & 0x0F) << 4;
+}
+
+void SimOled::write(const uint8_t *data, size_t len)
+{
+    _transfers++;
+    _bytes += len + 1;
+    if (len == 0)
+        return;
+    if (data[0] & 0x40)
+    {
+        for (size_t i = 1; i < len; i++)
+        {
+            _ram[_page][_column] = data[i];
+            _column = (_column + 1) % SIM_OLED_COLUMNS;
+        }
+        _data_bytes += len - 1;
+    }
+    else
+    {
+        for (size_t i = 1; i < len; i++)
+            command(data[i]);
+    }
+}
+
+/**
+ * @brief Prints the traffic and the visible display RAM, two pixel rows per line.
+ */
+void SimOled::report(void)
+{
+    power(false);
+    fprintf(stderr, "\nOLED: %u I2C transfers, %u bytes (%u display data), %.3f s on\n", _transfers,
+            _bytes, _data_bytes, _on_time / 1e6);
+    for (int y = 0; y < SIM_OLED_H_PAGES * 8; y += 2)
+    {
+        char line[SIM_OLED_W + 1];
+        for (int x = 0; x < SIM_OLED_W; x++)
+        {
+            const uint8_t *col = &_ram[0][SIM_OLED_X + x];
+            bool top = col[(y / 8) * SIM_OLED_COLUMNS] & (1 << (y % 8));
+            bool bottom = col[((y + 1) / 8) * SIM_OLED_COLUMNS] & (1 << ((y + 1) % 8));
+            line[x] = top ? (bottom ? ':' : '\'') : (bottom ? '.' : ' ');
+        }
+        line[SIM_OLED_W] = '\0';
+        fprintf(stderr, "  |%s|\n", line);
+    }
+}
+
+static void sim_oled_report(void)
+{
+    sim_oled.report();
+}
+
+/**
+ * @brief Connects the OLED controller to the I2C bus.
+ */
+void sim_oled_init(void)
+{
+    sim_i2c_attach(SIM_OLED_ADDR, &sim_oled);
+    sim_on_exit(sim_oled_report);
+}
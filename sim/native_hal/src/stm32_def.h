@@ -0,0 +1,18 @@
+#ifndef _STM32_DEF_
+#define _STM32_DEF_
+
+#include "stm32l0xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void _Error_Handler(const char *file, int line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define Error_Handler() _Error_Handler(__FILE__, __LINE__)
+
+#endif /* _STM32_DEF_ */
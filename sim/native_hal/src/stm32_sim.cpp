@@ -0,0 +1,508 @@
+#include <Arduino.h>
+#include <STM32LowPower.h>
+#include <STM32RTC.h>
+#include "stm32_def.h"
+#include "sim.h"
+
+/*
+ * STM32L073 peripherals and HAL modules used by the firmware, the RTC and the low
+ * power modes.
+ */
+
+// LSE ticks counted by LPTIM1
+#define SIM_LSE_HZ 32768
+// Wake up from STOP mode: regulator, MSI start and clock configuration restore
+#define SIM_STOP_WAKEUP_US 50
+
+extern "C" {
+void LPTIM1_IRQHandler(void) __attribute__((weak));
+void DMA1_Channel1_IRQHandler(void) __attribute__((weak));
+void DMA1_Channel2_3_IRQHandler(void) __attribute__((weak));
+void DMA1_Channel4_5_6_7_IRQHandler(void) __attribute__((weak));
+void ADC1_COMP_IRQHandler(void) __attribute__((weak));
+void TIM2_IRQHandler(void) __attribute__((weak));
+void TIM6_DAC_IRQHandler(void) __attribute__((weak));
+void I2C1_IRQHandler(void) __attribute__((weak));
+}
+
+static uint32_t sim_lptim_read_isr(void);
+static void sim_lptim_write_icr(uint32_t value);
+static uint32_t sim_lptim_read_cr(void);
+static void sim_lptim_write_cr(uint32_t value);
+static uint32_t sim_lptim_read_cnt(void);
+static uint32_t sim_reg_zero(void);
+static void sim_reg_ignore(uint32_t value);
+
+LPTIM_TypeDef sim_LPTIM1 = {
+    .ISR = {sim_lptim_read_isr, sim_reg_ignore},
+    .ICR = {sim_reg_zero, sim_lptim_write_icr},
+    .IER = 0,
+    .CFGR = 0,
+    .CR = {sim_lptim_read_cr, sim_lptim_write_cr},
+    .CMP = 0,
+    .ARR = 0,
+    .CNT = {sim_lptim_read_cnt, sim_reg_ignore},
+};
+EXTI_TypeDef sim_EXTI;
+DMA_TypeDef sim_DMA1;
+DMA_Channel_TypeDef sim_DMA1_Channel[7];
+ADC_TypeDef sim_ADC1;
+USART_TypeDef sim_USART[5];
+STM32LowPower LowPower;
+
+static uint32_t sim_nvic_enabled = 0;
+static uint32_t sim_lptim_isr = LPTIM_ISR_ARROK;
+static uint32_t sim_lptim_cr = 0;
+static uint64_t sim_lptim_start = 0; // LSE tick of the counter start
+static bool sim_lptim_running = false;
+
+static uint32_t sim_reg_zero(void)
+{
+    return 0;
+}
+
+static void sim_reg_ignore(uint32_t value)
+{
+    (void)value;
+}
+
+static SimIrqFn sim_vector(IRQn_Type IRQn)
+{
+    switch (IRQn)
+    {
+    case LPTIM1_IRQn:
+        return LPTIM1_IRQHandler;
+    case DMA1_Channel1_IRQn:
+        return DMA1_Channel1_IRQHandler;
+    case DMA1_Channel2_3_IRQn:
+        return DMA1_Channel2_3_IRQHandler;
+    case DMA1_Channel4_5_6_7_IRQn:
+        return DMA1_Channel4_5_6_7_IRQHandler;
+    case ADC1_COMP_IRQn:
+        return ADC1_COMP_IRQHandler;
+    case TIM2_IRQn:
+        return TIM2_IRQHandler;
+    case TIM6_DAC_IRQn:
+        return TIM6_DAC_IRQHandler;
+    case I2C1_IRQn:
+        return I2C1_IRQHandler;
+    default:
+        return nullptr;
+    }
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+    (void)IRQn;
+    (void)PreemptPriority;
+    (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    sim_nvic_enabled |= 1U << IRQn;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    sim_nvic_enabled &= ~(1U << IRQn);
+}
+
+/**
+ * @brief Raises a peripheral interrupt, if it is enabled in the NVIC.
+ *
+ * @param IRQn The interrupt.
+ * @param wakes_stop Non zero if the interrupt goes through an EXTI line.
+ */
+void sim_nvic_raise(IRQn_Type IRQn, int wakes_stop)
+{
+    if (sim_nvic_enabled & (1U << IRQn))
+        sim_irq(sim_vector(IRQn), wakes_stop);
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return millis();
+}
+
+void HAL_SuspendTick(void)
+{
+    sim_systick_suspend(true);
+}
+
+void HAL_ResumeTick(void)
+{
+    sim_systick_suspend(false);
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return sim_irq_enabled() ? 0 : 1;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+    sim_irq_enable(!(priMask & 1));
+}
+
+void __disable_irq(void)
+{
+    sim_irq_enable(false);
+}
+
+void __enable_irq(void)
+{
+    sim_irq_enable(true);
+}
+
+/**
+ * @brief Sleep mode until an interrupt, SysTick wakes the core at the next millisecond.
+ */
+void __WFI(void)
+{
+    sim_idle(SIM_SLEEP, 1000 - sim_systick() % 1000);
+}
+
+void _Error_Handler(const char *file, int line)
+{
+    fprintf(stderr, "sim: Error_Handler() called from %s:%d\n", file, line);
+    abort();
+}
+
+/*
+ * LPTIM1: continuous mode from the LSE, auto-reload match interrupt on EXTI line 29.
+ */
+
+static uint64_t sim_lse_ticks(simtime_t t)
+{
+    return t * SIM_LSE_HZ / 1000000;
+}
+
+static simtime_t sim_lse_time(uint64_t ticks)
+{
+    return (ticks * 1000000 + SIM_LSE_HZ - 1) / SIM_LSE_HZ;
+}
+
+static uint32_t sim_lptim_period(void)
+{
+    return (sim_LPTIM1.ARR & 0xFFFF) + 1;
+}
+
+static void sim_lptim_match(void *arg)
+{
+    (void)arg;
+    if (!sim_lptim_running)
+        return;
+
+    sim_lptim_isr |= LPTIM_ISR_ARRM;
+    if ((sim_LPTIM1.IER & LPTIM_IER_ARRMIE) && (sim_EXTI.IMR & EXTI_IMR_IM29))
+        sim_nvic_raise(LPTIM1_IRQn, true);
+
+    uint64_t elapsed = sim_lse_ticks(sim_now()) - sim_lptim_start;
+    uint64_t next = (elapsed / sim_lptim_period() + 1) * sim_lptim_period();
+    sim_at(sim_lse_time(sim_lptim_start + next), sim_lptim_match, nullptr);
+}
+
+static uint32_t sim_lptim_read_isr(void)
+{
+    return sim_lptim_isr;
+}
+
+static void sim_lptim_write_icr(uint32_t value)
+{
+    sim_lptim_isr &= ~value;
+}
+
+static uint32_t sim_lptim_read_cr(void)
+{
+    return sim_lptim_cr;
+}
+
+static void sim_lptim_write_cr(uint32_t value)
+{
+    sim_lptim_cr = value & LPTIM_CR_ENABLE;
+    if (!(value & LPTIM_CR_ENABLE))
+    {
+        sim_lptim_running = false;
+        sim_cancel(sim_lptim_match, nullptr);
+        return;
+    }
+    sim_lptim_isr |= LPTIM_ISR_ARROK;
+    if ((value & LPTIM_CR_CNTSTRT) && !sim_lptim_running)
+    {
+        sim_lptim_running = true;
+        sim_lptim_start = sim_lse_ticks(sim_now());
+        sim_at(sim_lse_time(sim_lptim_start + sim_lptim_period()), sim_lptim_match, nullptr);
+    }
+}
+
+static uint32_t sim_lptim_read_cnt(void)
+{
+    if (!sim_lptim_running)
+        return 0;
+    return (sim_lse_ticks(sim_now()) - sim_lptim_start) % sim_lptim_period();
+}
+
+/*
+ * ADC: conversions of the battery voltage divider and of VREFINT.
+ *
+ * VDDA comes from the regulator, 3.3 V until the battery gets within its dropout. A
+ * start converts the selected channels in ascending order, each after its sampling and
+ * conversion time times the oversampling ratio, and raises the ADC interrupt on every
+ * end of conversion.
+ */
+
+// ADC clock, regulator dropout and VREFINT voltage
+#define SIM_ADC_HZ 8000000
+#define SIM_VDDA_V 3.3
+#define SIM_LDO_DROPOUT_V 0.05
+#define SIM_VREFINT_V 1.224
+
+uint16_t sim_vrefint_cal = (uint16_t)(SIM_VREFINT_V / 3.0 * 4095 + 0.5);
+
+static ADC_HandleTypeDef *sim_adc;
+static uint32_t sim_adc_pending; // Channels left to convert
+
+static double sim_adc_vdda(void)
+{
+    double vdda = sim_opt.battery_v - SIM_LDO_DROPOUT_V;
+    return vdda < SIM_VDDA_V ? vdda : SIM_VDDA_V;
+}
+
+static uint32_t sim_adc_ratio(const ADC_HandleTypeDef *hadc)
+{
+    if (hadc->Init.OversamplingMode != ENABLE)
+        return 1;
+    return 2U << ((hadc->Init.Oversample.Ratio >> 2) & 0x7);
+}
+
+/**
+ * @brief Converts a channel, scaled and shifted by the oversampler.
+ */
+static uint32_t sim_adc_convert(const ADC_HandleTypeDef *hadc, uint32_t channel)
+{
+    double v;
+    if (channel == ADC_CHANNEL_VREFINT)
+        v = SIM_VREFINT_V;
+    else if (channel == ADC_CHANNEL_14)
+        v = sim_opt.battery_v / 2; // Battery voltage divider
+    else
+        v = 0;
+
+    uint32_t code = (uint32_t)(v / sim_adc_vdda() * 4095 + 0.5);
+    if (code > 4095)
+        code = 4095;
+    uint32_t shift = 0;
+    if (hadc->Init.OversamplingMode == ENABLE)
+        shift = (hadc->Init.Oversample.RightBitShift >> 5) & 0xF;
+    return (code * sim_adc_ratio(hadc)) >> shift;
+}
+
+static void sim_adc_eoc(void *arg);
+
+/**
+ * @brief Starts the conversion of the next selected channel.
+ */
+static void sim_adc_next(void)
+{
+    static const double cycles[8] = {1.5, 3.5, 7.5, 12.5, 19.5, 39.5, 79.5, 160.5};
+    double sample = cycles[sim_adc->Init.SamplingTime & 0x7] + 12.5;
+    simtime_t us = (simtime_t)(sample * sim_adc_ratio(sim_adc) * 1e6 / SIM_ADC_HZ + 0.5);
+    sim_at(sim_now() + us, sim_adc_eoc, nullptr);
+}
+
+static void sim_adc_eoc(void *arg)
+{
+    (void)arg;
+    uint32_t channel = __builtin_ctz(sim_adc_pending);
+    sim_adc_pending &= ~(1U << channel);
+    sim_adc->Instance->DR = sim_adc_convert(sim_adc, channel);
+    sim_adc->Instance->ISR |= ADC_FLAG_EOC | (sim_adc_pending ? 0 : ADC_FLAG_EOS);
+    if (sim_adc_pending)
+        sim_adc_next();
+    sim_nvic_raise(ADC1_COMP_IRQn, 0);
+}
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc)
+{
+    hadc->State = 1;
+    hadc->Channels = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_DeInit(ADC_HandleTypeDef *hadc)
+{
+    HAL_ADC_Stop_IT(hadc);
+    hadc->State = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig)
+{
+    if (sConfig->Rank == ADC_RANK_NONE)
+        hadc->Channels &= ~(1U << sConfig->Channel);
+    else
+        hadc->Channels |= 1U << sConfig->Channel;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc, uint32_t SingleDiff)
+{
+    (void)hadc;
+    (void)SingleDiff;
+    // 83 ADC clock cycles at 8 MHz
+    sim_busy(11);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc)
+{
+    (void)hadc;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc)
+{
+    (void)hadc;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->State == 0 || hadc->Channels == 0 || sim_adc_pending)
+        return HAL_ERROR;
+    sim_adc = hadc;
+    sim_adc_pending = hadc->Channels;
+    hadc->Instance->ISR = 0;
+    sim_adc_next();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop_IT(ADC_HandleTypeDef *hadc)
+{
+    (void)hadc;
+    sim_cancel(sim_adc_eoc, nullptr);
+    sim_adc_pending = 0;
+    return HAL_OK;
+}
+
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc)
+{
+    hadc->Instance->ISR &= ~ADC_FLAG_EOC;
+    return hadc->Instance->DR;
+}
+
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->Instance->ISR & ADC_FLAG_EOC)
+    {
+        HAL_ADC_ConvCpltCallback(hadc);
+        hadc->Instance->ISR &= ~(ADC_FLAG_EOC | ADC_FLAG_EOS);
+    }
+}
+
+__attribute__((weak)) void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    (void)hadc;
+}
+
+/*
+ * DMA and UART reception to idle, the characters are written by HardwareSerial.
+ */
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    hdma->Instance->CNDTR = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)
+{
+    hdma->Instance->CNDTR = 0;
+    HAL_DMA_IRQHandler(hdma);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+    hdma->Instance->CNDTR = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief Clears the flags of the channel, the callbacks of the transfers are not modelled.
+ */
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+    int n = hdma->Instance - sim_DMA1_Channel + 1;
+    DMA1->ISR &= ~(SIM_DMA_FLAG_TC(n) | SIM_DMA_FLAG_HT(n));
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    huart->RxState = HAL_UART_STATE_READY;
+    huart->ReceptionType = HAL_UART_RECEPTION_STANDARD;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    if (huart->RxState != HAL_UART_STATE_READY || huart->hdmarx == nullptr)
+        return HAL_BUSY;
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->ReceptionType = HAL_UART_RECEPTION_TOIDLE;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    huart->hdmarx->Instance->CNDTR = Size;
+    // Starting the channel clears its flags
+    HAL_DMA_IRQHandler(huart->hdmarx);
+    return HAL_OK;
+}
+
+/*
+ * Low power modes and RTC.
+ */
+
+/**
+ * @brief Sleep mode with SysTick suspended, like LowPower_sleep(): millis() stands still.
+ */
+void STM32LowPower::sleep(uint32_t ms)
+{
+    HAL_SuspendTick();
+    sim_idle(SIM_SLEEP, (simtime_t)ms * 1000);
+    HAL_ResumeTick();
+}
+
+void STM32LowPower::deepSleep(uint32_t ms)
+{
+    sim_idle(SIM_STOP, (simtime_t)ms * 1000);
+    sim_busy(SIM_STOP_WAKEUP_US);
+}
+
+void STM32LowPower::attachInterruptWakeup(uint32_t pin, voidFuncPtrVoid callback, uint32_t mode,
+                                          LP_Mode LowPowerMode)
+{
+    (void)LowPowerMode;
+    attachInterrupt(pin, callback, mode);
+}
+
+void STM32RTC::begin(bool resetTime, Hour_Format format)
+{
+    (void)format;
+    if (resetTime)
+        setEpoch(946684800);
+}
+
+time_t STM32RTC::getEpoch(uint32_t *subSeconds)
+{
+    int64_t us = _epoch_us + (int64_t)sim_now();
+    if (subSeconds != nullptr)
+        *subSeconds = (us % 1000000) / 1000;
+    return (time_t)(us / 1000000);
+}
+
+void STM32RTC::setEpoch(time_t ts, uint32_t subSeconds)
+{
+    _epoch_us = (int64_t)ts * 1000000 + subSeconds * 1000 - (int64_t)sim_now();
+    _time_set = true;
+}
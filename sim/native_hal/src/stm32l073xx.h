@@ -0,0 +1,150 @@
+#ifndef __STM32L073xx_H
+#define __STM32L073xx_H
+
+/*
+ * Stand-in for the STM32L073 device header. Only the peripherals used by the firmware
+ * are modelled. Registers with side effects on read or write are SimReg, see
+ * stm32_sim.cpp.
+ */
+
+#include <stdint.h>
+
+#define __IO volatile
+#define __I volatile const
+
+typedef enum
+{
+    RTC_IRQn = 2,
+    EXTI0_1_IRQn = 5,
+    EXTI2_3_IRQn = 6,
+    EXTI4_15_IRQn = 7,
+    DMA1_Channel1_IRQn = 9,
+    DMA1_Channel2_3_IRQn = 10,
+    DMA1_Channel4_5_6_7_IRQn = 11,
+    ADC1_COMP_IRQn = 12,
+    LPTIM1_IRQn = 13,
+    USART4_5_IRQn = 14,
+    TIM2_IRQn = 15,
+    TIM6_DAC_IRQn = 17,
+    I2C1_IRQn = 23,
+    SIM_IRQn_COUNT = 32,
+} IRQn_Type;
+
+#ifdef __cplusplus
+struct SimReg
+{
+    uint32_t (*read)(void);
+    void (*write)(uint32_t value);
+
+    operator uint32_t() const { return read(); }
+    SimReg &operator=(uint32_t value) { write(value); return *this; }
+    SimReg &operator|=(uint32_t value) { write(read() | value); return *this; }
+    SimReg &operator&=(uint32_t value) { write(read() & value); return *this; }
+};
+
+typedef struct
+{
+    SimReg ISR;
+    SimReg ICR;
+    __IO uint32_t IER;
+    __IO uint32_t CFGR;
+    SimReg CR;
+    __IO uint32_t CMP;
+    __IO uint32_t ARR;
+    SimReg CNT;
+} LPTIM_TypeDef;
+#endif
+
+typedef struct
+{
+    __IO uint32_t IMR;
+    __IO uint32_t EMR;
+    __IO uint32_t RTSR;
+    __IO uint32_t FTSR;
+    __IO uint32_t SWIER;
+    __IO uint32_t PR;
+} EXTI_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t ISR;
+    __IO uint32_t IFCR;
+} DMA_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CCR;
+    __IO uint32_t CNDTR;
+    __IO uint32_t CPAR;
+    __IO uint32_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t ISR;
+    __IO uint32_t IER;
+    __IO uint32_t CR;
+    __IO uint32_t CFGR1;
+    __IO uint32_t CFGR2;
+    __IO uint32_t SMPR;
+    __IO uint32_t TR;
+    __IO uint32_t CHSELR;
+    __IO uint32_t DR;
+    __IO uint32_t CALFACT;
+    __IO uint32_t CCR;
+} ADC_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR1;
+    __IO uint32_t ISR;
+    __IO uint32_t RDR;
+    __IO uint32_t TDR;
+} USART_TypeDef;
+
+#ifdef __cplusplus
+extern "C" {
+extern LPTIM_TypeDef sim_LPTIM1;
+#endif
+extern EXTI_TypeDef sim_EXTI;
+extern DMA_TypeDef sim_DMA1;
+extern DMA_Channel_TypeDef sim_DMA1_Channel[7];
+extern ADC_TypeDef sim_ADC1;
+extern USART_TypeDef sim_USART[5];
+#ifdef __cplusplus
+}
+#endif
+
+#define LPTIM1 (&sim_LPTIM1)
+#define EXTI (&sim_EXTI)
+#define DMA1 (&sim_DMA1)
+#define DMA1_Channel1 (&sim_DMA1_Channel[0])
+#define DMA1_Channel2 (&sim_DMA1_Channel[1])
+#define DMA1_Channel3 (&sim_DMA1_Channel[2])
+#define DMA1_Channel4 (&sim_DMA1_Channel[3])
+#define DMA1_Channel5 (&sim_DMA1_Channel[4])
+#define DMA1_Channel6 (&sim_DMA1_Channel[5])
+#define DMA1_Channel7 (&sim_DMA1_Channel[6])
+#define ADC1 (&sim_ADC1)
+#define USART1 (&sim_USART[0])
+#define USART2 (&sim_USART[1])
+#define USART4 (&sim_USART[3])
+#define USART5 (&sim_USART[4])
+
+#define LPTIM_ISR_ARRM (1U << 1)
+#define LPTIM_ISR_ARROK (1U << 4)
+#define LPTIM_ICR_ARRMCF (1U << 1)
+#define LPTIM_ICR_ARROKCF (1U << 4)
+#define LPTIM_IER_ARRMIE (1U << 1)
+#define LPTIM_CR_ENABLE (1U << 0)
+#define LPTIM_CR_SNGSTRT (1U << 1)
+#define LPTIM_CR_CNTSTRT (1U << 2)
+
+#define EXTI_IMR_IM29 (1U << 29)
+
+// Data EEPROM, mapped at the same address as on the MCU, see eeprom_sim.cpp
+#define DATA_EEPROM_BASE 0x08080000UL
+#define DATA_EEPROM_BANK2_END 0x080817FFUL
+#define DATA_EEPROM_END DATA_EEPROM_BANK2_END
+
+#endif /* __STM32L073xx_H */
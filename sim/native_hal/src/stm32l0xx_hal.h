@@ -0,0 +1,260 @@
+#ifndef __STM32L0xx_HAL_H
+#define __STM32L0xx_HAL_H
+
+/*
+ * Stand-in for the STM32L0 HAL, covering the modules used by the firmware.
+ */
+
+#include <stdint.h>
+#include "stm32l073xx.h"
+
+typedef enum
+{
+    HAL_OK = 0x00,
+    HAL_ERROR = 0x01,
+    HAL_BUSY = 0x02,
+    HAL_TIMEOUT = 0x03,
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+    DISABLE = 0,
+    ENABLE = !DISABLE,
+} FunctionalState;
+
+#define GPIO_NOPULL 0x0U
+#define GPIO_PULLUP 0x1U
+#define GPIO_PULLDOWN 0x2U
+
+// RCC, the clocks are always running
+#define RCC_LPTIM1CLKSOURCE_LSE 0x3U
+#define __HAL_RCC_LPTIM1_CONFIG(source) ((void)(source))
+#define __HAL_RCC_LPTIM1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMA1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_ADC1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_SYSCFG_CLK_ENABLE() ((void)0)
+
+// ADC
+#define ADC_CLOCK_SYNC_PCLK_DIV2 0x0U
+#define ADC_RESOLUTION_12B 0x0U
+#define ADC_SAMPLETIME_39CYCLES_5 0x5U
+#define ADC_SAMPLETIME_160CYCLES_5 0x7U
+#define ADC_SCAN_DIRECTION_FORWARD 0x1U
+#define ADC_DATAALIGN_RIGHT 0x0U
+#define ADC_EXTERNALTRIGCONVEDGE_NONE 0x0U
+#define ADC_SOFTWARE_START 0x10U
+#define ADC_EOC_SINGLE_CONV 0x4U
+#define ADC_OVR_DATA_PRESERVED 0x0U
+#define ADC_CHANNEL_14 14U
+#define ADC_CHANNEL_VREFINT 17U
+#define ADC_RANK_CHANNEL_NUMBER 0x1000U
+#define ADC_RANK_NONE 0x1001U
+#define ADC_SINGLE_ENDED 0x0U
+#define ADC_OVERSAMPLING_RATIO_16 0xCU
+#define ADC_OVERSAMPLING_RATIO_64 0x14U
+#define ADC_OVERSAMPLING_RATIO_256 0x1CU
+#define ADC_RIGHTBITSHIFT_NONE 0x0U
+#define ADC_RIGHTBITSHIFT_2 0x40U
+#define ADC_RIGHTBITSHIFT_4 0x80U
+#define ADC_TRIGGEREDMODE_SINGLE_TRIGGER 0x0U
+#define ADC_FLAG_EOC 0x4U
+#define ADC_FLAG_EOS 0x8U
+
+// Factory VREFINT conversion at VDDA = 3.0 V
+extern uint16_t sim_vrefint_cal;
+#define VREFINT_CAL_ADDR (&sim_vrefint_cal)
+
+typedef struct
+{
+    uint32_t Ratio;
+    uint32_t RightBitShift;
+    uint32_t TriggeredMode;
+} ADC_OversamplingTypeDef;
+
+typedef struct
+{
+    uint32_t OversamplingMode;
+    ADC_OversamplingTypeDef Oversample;
+    uint32_t ClockPrescaler;
+    uint32_t Resolution;
+    uint32_t SamplingTime;
+    uint32_t ScanConvMode;
+    uint32_t DataAlign;
+    uint32_t ContinuousConvMode;
+    uint32_t DiscontinuousConvMode;
+    uint32_t ExternalTrigConvEdge;
+    uint32_t ExternalTrigConv;
+    uint32_t DMAContinuousRequests;
+    uint32_t EOCSelection;
+    uint32_t Overrun;
+    uint32_t LowPowerAutoWait;
+    uint32_t LowPowerFrequencyMode;
+    uint32_t LowPowerAutoPowerOff;
+} ADC_InitTypeDef;
+
+typedef struct
+{
+    ADC_TypeDef *Instance;
+    ADC_InitTypeDef Init;
+    uint32_t Channels;
+    uint32_t State;
+} ADC_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t Channel;
+    uint32_t Rank;
+} ADC_ChannelConfTypeDef;
+
+// DMA
+#define DMA_REQUEST_6 6U
+#define DMA_REQUEST_12 12U
+#define DMA_PERIPH_TO_MEMORY 0x0U
+#define DMA_MEMORY_TO_PERIPH 0x10U
+#define DMA_PINC_DISABLE 0x0U
+#define DMA_MINC_ENABLE 0x80U
+#define DMA_PDATAALIGN_BYTE 0x0U
+#define DMA_MDATAALIGN_BYTE 0x0U
+#define DMA_NORMAL 0x0U
+#define DMA_CIRCULAR 0x20U
+#define DMA_PRIORITY_LOW 0x0U
+#define DMA_PRIORITY_HIGH 0x2000U
+
+typedef struct
+{
+    uint32_t Request;
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+    DMA_Channel_TypeDef *Instance;
+    DMA_InitTypeDef Init;
+    void *Parent;
+} DMA_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(handle) ((handle)->Instance->CNDTR)
+#define __HAL_DMA_GET_FLAG(handle, flag) (DMA1->ISR & (flag))
+// Transfer complete and half transfer flags of channel n in DMA1->ISR
+#define SIM_DMA_FLAG_TC(n) (0x2U << (4 * ((n) - 1)))
+#define SIM_DMA_FLAG_HT(n) (0x4U << (4 * ((n) - 1)))
+#define DMA_FLAG_TC6 SIM_DMA_FLAG_TC(6)
+#define DMA_FLAG_HT6 SIM_DMA_FLAG_HT(6)
+#define __HAL_LINKDMA(handle, field, dma) \
+    do                                     \
+    {                                      \
+        (handle)->field = &(dma);          \
+        (dma).Parent = (handle);           \
+    } while (0)
+
+// UART
+typedef enum
+{
+    HAL_UART_STATE_RESET = 0x00U,
+    HAL_UART_STATE_READY = 0x20U,
+    HAL_UART_STATE_BUSY_RX = 0x22U,
+} HAL_UART_StateTypeDef;
+
+#define HAL_UART_RECEPTION_STANDARD 0x00U
+#define HAL_UART_RECEPTION_TOIDLE 0x01U
+
+typedef struct
+{
+    USART_TypeDef *Instance;
+    uint8_t *pRxBuffPtr;
+    uint16_t RxXferSize;
+    uint32_t ReceptionType;
+    HAL_UART_StateTypeDef RxState;
+    DMA_HandleTypeDef *hdmarx;
+} UART_HandleTypeDef;
+
+// I2C, the transfers go to the sim_i2c_attach() models
+typedef enum
+{
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U,
+    HAL_I2C_STATE_BUSY_TX = 0x21U,
+} HAL_I2C_StateTypeDef;
+
+#define I2C_FASTMODEPLUS_I2C1 (1U << 12)
+
+typedef struct
+{
+    uint32_t Timing; // Bus clock in Hz, not the TIMINGR value
+} I2C_InitTypeDef;
+
+typedef struct
+{
+    I2C_InitTypeDef Init;
+    volatile HAL_I2C_StateTypeDef State;
+    DMA_HandleTypeDef *hdmatx;
+} I2C_HandleTypeDef;
+
+// Data EEPROM
+#define FLASH_TYPEPROGRAMDATA_BYTE 0x00U
+#define FLASH_TYPEPROGRAMDATA_HALFWORD 0x01U
+#define FLASH_TYPEPROGRAMDATA_WORD 0x02U
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_DeInit(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig);
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc, uint32_t SingleDiff);
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Stop_IT(ADC_HandleTypeDef *hadc);
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc);
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc);
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+void HAL_I2CEx_EnableFastModePlus(uint32_t ConfigFastModePlus);
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Unlock(void);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Erase(uint32_t Address);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Program(uint32_t TypeProgram, uint32_t Address, uint32_t Data);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+void sim_nvic_raise(IRQn_Type IRQn, int wakes_stop);
+
+uint32_t HAL_GetTick(void);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32L0xx_HAL_H */
@@ -0,0 +1,686 @@
+#include <Arduino.h>
+#include "sim.h"
+
+/*
+ * Semtech SX1276 on SPI2, at register level.
+ *
+ * The LoRa and FSK register pages, the FIFOs and the operating modes are modelled so the
+ * LMIC radio driver runs unchanged. A transmission ends with TxDone (PacketSent in FSK)
+ * after the airtime of the frame, computed from the modem registers as in the datasheet.
+ * A receive window ends with RxTimeout after the symbol timeout, or with RxDone when a
+ * downlink injected from the command line is due; the downlink preamble starts when the
+ * window opens. The interrupts go out on DIO0..DIO2 as mapped by RegDioMapping1.
+ *
+ * The time spent in TX and RX is accounted per uplink and reported on exit.
+ */
+
+#define SIM_RADIO_NSS PB12
+#define SIM_RADIO_RST PB10
+#define SIM_RADIO_DIO0 PB11
+#define SIM_RADIO_DIO1 PC13
+#define SIM_RADIO_DIO2 PB9
+
+#define SIM_RADIO_REGS 0x80
+#define SIM_RADIO_FSK_FIFO 64
+#define SIM_RADIO_DOWNLINKS 16
+#define SIM_RADIO_XOSC 32000000.0
+
+// Common registers
+#define REG_FIFO 0x00
+#define REG_OPMODE 0x01
+#define REG_FRF_MSB 0x06
+#define REG_FRF_MID 0x07
+#define REG_FRF_LSB 0x08
+#define REG_DIO_MAPPING1 0x40
+#define REG_VERSION 0x42
+
+// LoRa page
+#define LORA_FIFO_ADDR_PTR 0x0D
+#define LORA_FIFO_TX_BASE 0x0E
+#define LORA_FIFO_RX_BASE 0x0F
+#define LORA_FIFO_RX_CURRENT 0x10
+#define LORA_IRQ_MASK 0x11
+#define LORA_IRQ_FLAGS 0x12
+#define LORA_RX_NB_BYTES 0x13
+#define LORA_PKT_SNR 0x19
+#define LORA_PKT_RSSI 0x1A
+#define LORA_RSSI 0x1B
+#define LORA_MODEM_CONFIG1 0x1D
+#define LORA_MODEM_CONFIG2 0x1E
+#define LORA_SYMB_TIMEOUT 0x1F
+#define LORA_PREAMBLE_MSB 0x20
+#define LORA_PREAMBLE_LSB 0x21
+#define LORA_PAYLOAD_LENGTH 0x22
+#define LORA_PAYLOAD_MAX 0x23
+#define LORA_MODEM_CONFIG3 0x26
+#define LORA_RSSI_WIDEBAND 0x2C
+
+// FSK page
+#define FSK_BITRATE_MSB 0x02
+#define FSK_BITRATE_LSB 0x03
+#define FSK_RX_TIMEOUT2 0x21
+#define FSK_PREAMBLE_MSB 0x25
+#define FSK_PREAMBLE_LSB 0x26
+#define FSK_SYNC_CONFIG 0x27
+#define FSK_PACKET_CONFIG1 0x30
+#define FSK_PAYLOAD_LENGTH 0x32
+#define FSK_IMAGE_CAL 0x3B
+#define FSK_IRQ_FLAGS1 0x3E
+#define FSK_IRQ_FLAGS2 0x3F
+
+#define OPMODE_LORA 0x80
+#define OPMODE_SHARED_REG 0x40
+#define OPMODE_MASK 0x07
+#define MODE_SLEEP 0
+#define MODE_STANDBY 1
+#define MODE_TX 3
+#define MODE_RX 5
+#define MODE_RX_SINGLE 6
+
+#define LORA_IRQ_RX_TIMEOUT 0x80
+#define LORA_IRQ_RX_DONE 0x40
+#define LORA_IRQ_TX_DONE 0x08
+#define FSK_IRQ1_MODE_READY 0x80
+#define FSK_IRQ1_TIMEOUT 0x04
+#define FSK_IRQ2_PACKET_SENT 0x08
+#define FSK_IRQ2_PAYLOAD_READY 0x04
+#define FSK_IRQ2_CRC_OK 0x02
+
+// RSSI register offset in the 868 MHz band, and noise floor of an empty channel
+#define RSSI_OFFSET_HF 157
+#define NOISE_DBM -120
+
+struct SimDownlink
+{
+    simtime_t at;
+    uint8_t data[255];
+    uint8_t len;
+    int rssi;
+    double snr;
+};
+
+static SimDownlink sim_downlinks[SIM_RADIO_DOWNLINKS];
+static int sim_downlink_count = 0;
+
+class SimRadio : public SimSpiDevice
+{
+public:
+    void select(bool selected) override
+    {
+        _first = selected;
+    }
+
+    uint8_t transfer(uint8_t out) override
+    {
+        if (_first)
+        {
+            // Address byte, the MSB selects a write
+            _first = false;
+            _addr = out & 0x7F;
+            _write = out & 0x80;
+            return 0;
+        }
+
+        uint8_t in = 0;
+        if (_write)
+            write(_addr, out);
+        else
+            in = read(_addr);
+        if (_addr != REG_FIFO)
+            _addr = (_addr + 1) % SIM_RADIO_REGS;
+        return in;
+    }
+
+    void reset(void);
+    void report(void);
+
+private:
+    bool lora(void) const
+    {
+        return _fsk[REG_OPMODE] & OPMODE_LORA;
+    }
+
+    uint8_t mode(void) const
+    {
+        return _fsk[REG_OPMODE] & OPMODE_MASK;
+    }
+
+    uint8_t *reg(uint8_t addr);
+    uint8_t read(uint8_t addr);
+    void write(uint8_t addr, uint8_t value);
+    void set_opmode(uint8_t value);
+    void enter(uint8_t mode);
+    void start_tx(void);
+    void start_rx(bool single);
+    void lora_irq(uint8_t flag);
+    void update_dio(void);
+    double frequency(void) const;
+    double lora_symbol_us(void) const;
+    simtime_t lora_airtime(uint8_t len) const;
+    simtime_t fsk_airtime(uint8_t len) const;
+    const SimDownlink *take_downlink(void);
+
+    static void tx_done(void *arg);
+    static void rx_done(void *arg);
+    static void rx_timeout(void *arg);
+
+    // The LoRa page replaces the FSK one from 0x0D to 0x3F, the rest is common
+    uint8_t _fsk[SIM_RADIO_REGS];
+    uint8_t _lora[SIM_RADIO_REGS];
+    uint8_t _fifo[256];
+    uint8_t _fsk_fifo[SIM_RADIO_FSK_FIFO];
+    uint8_t _fsk_fifo_len;
+    uint8_t _fsk_fifo_pos;
+    SimDownlink _rx;
+    int _dio[3];
+
+    uint8_t _addr = 0;
+    bool _write = false;
+    bool _first = false;
+
+    // Radio-on accounting
+    simtime_t _since = 0;
+    simtime_t _tx_us[13] = {};
+    simtime_t _rx_us = 0;
+    simtime_t _uplink_start_on = 0;
+    simtime_t _uplink_max_us = 0;
+    uint32_t _uplinks = 0;
+    uint32_t _downlinks = 0;
+    uint8_t _tx_sf = 0;
+};
+
+static SimRadio sim_radio;
+
+/**
+ * @brief Puts the registers back to their reset values, the radio in FSK standby.
+ */
+void SimRadio::reset(void)
+{
+    sim_cancel(tx_done, this);
+    sim_cancel(rx_done, this);
+    sim_cancel(rx_timeout, this);
+    enter(MODE_STANDBY);
+
+    memset(_fsk, 0, sizeof(_fsk));
+    memset(_lora, 0, sizeof(_lora));
+    _fsk[REG_OPMODE] = 0x09; // FSK, low frequency registers, standby
+    _fsk[FSK_BITRATE_MSB] = 0x1A;
+    _fsk[FSK_BITRATE_LSB] = 0x0B;
+    _fsk[REG_FRF_MSB] = 0x6C;
+    _fsk[REG_FRF_MID] = 0x80;
+    _fsk[FSK_PREAMBLE_LSB] = 0x03;
+    _fsk[FSK_SYNC_CONFIG] = 0x93;
+    _fsk[FSK_PACKET_CONFIG1] = 0x90;
+    _fsk[FSK_PAYLOAD_LENGTH] = 0x40;
+    _fsk[FSK_IRQ_FLAGS1] = FSK_IRQ1_MODE_READY;
+    _fsk[REG_VERSION] = 0x12;
+    _lora[LORA_FIFO_TX_BASE] = 0x80;
+    _lora[LORA_MODEM_CONFIG1] = 0x72;
+    _lora[LORA_MODEM_CONFIG2] = 0x70;
+    _lora[LORA_SYMB_TIMEOUT] = 0x64;
+    _lora[LORA_PREAMBLE_LSB] = 0x08;
+    _lora[LORA_PAYLOAD_LENGTH] = 0x01;
+    _lora[LORA_PAYLOAD_MAX] = 0xFF;
+    _fsk_fifo_len = _fsk_fifo_pos = 0;
+    _dio[0] = _dio[1] = _dio[2] = -1;
+    update_dio();
+}
+
+/**
+ * @brief Returns the register an address refers to in the current page.
+ */
+uint8_t *SimRadio::reg(uint8_t addr)
+{
+    if (addr >= 0x0D && addr < 0x40 && lora() && !(_fsk[REG_OPMODE] & OPMODE_SHARED_REG))
+        return &_lora[addr];
+    return &_fsk[addr];
+}
+
+uint8_t SimRadio::read(uint8_t addr)
+{
+    if (addr == REG_FIFO)
+    {
+        if (lora())
+            return _fifo[_lora[LORA_FIFO_ADDR_PTR]++];
+        return _fsk_fifo_pos < _fsk_fifo_len ? _fsk_fifo[_fsk_fifo_pos++] : 0;
+    }
+    if (lora() && reg(addr) == &_lora[addr])
+    {
+        // Noise on an empty channel, LMIC seeds its random generator with it
+        if (addr == LORA_RSSI_WIDEBAND)
+            return rand();
+        if (addr == LORA_RSSI)
+            return NOISE_DBM + RSSI_OFFSET_HF + rand() % 5;
+    }
+    return *reg(addr);
+}
+
+void SimRadio::write(uint8_t addr, uint8_t value)
+{
+    if (addr == REG_FIFO)
+    {
+        if (lora())
+            _fifo[_lora[LORA_FIFO_ADDR_PTR]++] = value;
+        else if (_fsk_fifo_len < SIM_RADIO_FSK_FIFO)
+            _fsk_fifo[_fsk_fifo_len++] = value;
+        return;
+    }
+    if (addr == REG_OPMODE)
+    {
+        set_opmode(value);
+        return;
+    }
+    if (addr == REG_VERSION)
+        return;
+
+    uint8_t *r = reg(addr);
+    if (r == &_lora[LORA_IRQ_FLAGS])
+        *r &= ~value; // Cleared by writing 1
+    else if (r == &_fsk[FSK_IRQ_FLAGS1] || r == &_fsk[FSK_IRQ_FLAGS2])
+        return;
+    else if (r == &_fsk[FSK_IMAGE_CAL])
+        *r = value & ~0x60; // The image calibration is over at once
+    else
+        *r = value;
+    update_dio();
+}
+
+/**
+ * @brief Handles a write to RegOpMode, starting or stopping TX and RX.
+ */
+void SimRadio::set_opmode(uint8_t value)
+{
+    uint8_t prev = _fsk[REG_OPMODE];
+    // LongRangeMode only changes in sleep mode
+    if ((prev & OPMODE_MASK) != MODE_SLEEP)
+        value = (value & ~OPMODE_LORA) | (prev & OPMODE_LORA);
+    _fsk[REG_OPMODE] = value;
+    if ((value & OPMODE_MASK) == (prev & OPMODE_MASK) && !((value ^ prev) & OPMODE_LORA))
+        return;
+
+    // A new mode aborts the operation in progress
+    sim_cancel(tx_done, this);
+    sim_cancel(rx_done, this);
+    sim_cancel(rx_timeout, this);
+    _fsk[REG_OPMODE] = prev;
+    enter(value & OPMODE_MASK);
+    _fsk[REG_OPMODE] = value;
+    _fsk[FSK_IRQ_FLAGS1] = FSK_IRQ1_MODE_READY;
+    _fsk[FSK_IRQ_FLAGS2] = 0;
+
+    switch (mode())
+    {
+    case MODE_SLEEP:
+        // The FIFO is cleared in sleep mode
+        memset(_fifo, 0, sizeof(_fifo));
+        _fsk_fifo_len = _fsk_fifo_pos = 0;
+        break;
+    case MODE_TX:
+        start_tx();
+        break;
+    case MODE_RX:
+    case MODE_RX_SINGLE:
+        start_rx(mode() == MODE_RX_SINGLE);
+        break;
+    }
+    update_dio();
+}
+
+/**
+ * @brief Switches the operating mode, accounting the time spent in the previous one.
+ */
+void SimRadio::enter(uint8_t next)
+{
+    simtime_t spent = sim_now() - _since;
+    switch (mode())
+    {
+    case MODE_TX:
+        _tx_us[_tx_sf] += spent;
+        break;
+    case MODE_RX:
+    case MODE_RX_SINGLE:
+        _rx_us += spent;
+        break;
+    }
+    _since = sim_now();
+    _fsk[REG_OPMODE] = (_fsk[REG_OPMODE] & ~OPMODE_MASK) | next;
+}
+
+/**
+ * @brief Sends the frame in the FIFO, TxDone follows after its airtime.
+ */
+void SimRadio::start_tx(void)
+{
+    // An uplink ends when the next one starts
+    simtime_t on = _rx_us;
+    for (int sf = 0; sf < 13; sf++)
+        on += _tx_us[sf];
+    if (_uplinks && on - _uplink_start_on > _uplink_max_us)
+        _uplink_max_us = on - _uplink_start_on;
+    _uplink_start_on = on;
+    _uplinks++;
+
+    simtime_t airtime;
+    if (lora())
+    {
+        uint8_t len = _lora[LORA_PAYLOAD_LENGTH];
+        _tx_sf = _lora[LORA_MODEM_CONFIG2] >> 4;
+        airtime = lora_airtime(len);
+        sim_log("radio: TX %u bytes, %.1f MHz, SF%u, %.1f ms", len, frequency() / 1e6, _tx_sf,
+                airtime / 1e3);
+    }
+    else
+    {
+        // The length byte is in the FIFO
+        _tx_sf = 0;
+        airtime = fsk_airtime(_fsk_fifo_len ? _fsk_fifo_len - 1 : 0);
+        sim_log("radio: TX %u bytes, %.1f MHz, FSK, %.1f ms", _fsk_fifo_len ? _fsk_fifo_len - 1 : 0,
+                frequency() / 1e6, airtime / 1e3);
+    }
+    sim_at(sim_now() + airtime, tx_done, this);
+}
+
+/**
+ * @brief Opens a receive window, it ends with a timeout or with a downlink.
+ *
+ * @param single true for LoRa RXSINGLE, which ends on the symbol timeout.
+ */
+void SimRadio::start_rx(bool single)
+{
+    simtime_t timeout = 0;
+    if (lora())
+    {
+        // RSSI scans have RxDone masked, they never receive anything
+        if (_lora[LORA_IRQ_MASK] & LORA_IRQ_RX_DONE)
+            return;
+        if (single)
+        {
+            unsigned symbols = ((_lora[LORA_MODEM_CONFIG2] & 0x03) << 8) | _lora[LORA_SYMB_TIMEOUT];
+            timeout = (simtime_t)(symbols * lora_symbol_us());
+        }
+    }
+    else if (_fsk[FSK_RX_TIMEOUT2])
+    {
+        // Timeout without preamble, in units of 16 bits
+        double bit_us = 1e6 * ((_fsk[FSK_BITRATE_MSB] << 8) | _fsk[FSK_BITRATE_LSB]) / SIM_RADIO_XOSC;
+        timeout = (simtime_t)(_fsk[FSK_RX_TIMEOUT2] * 16 * bit_us);
+    }
+
+    const SimDownlink *dl = take_downlink();
+    if (dl != nullptr)
+    {
+        _rx = *dl;
+        simtime_t airtime = lora() ? lora_airtime(_rx.len) : fsk_airtime(_rx.len);
+        sim_log("radio: RX %u bytes, %.1f MHz, %d dBm, SNR %.1f dB", _rx.len, frequency() / 1e6,
+                _rx.rssi, _rx.snr);
+        sim_at(sim_now() + airtime, rx_done, this);
+    }
+    else if (timeout)
+    {
+        sim_at(sim_now() + timeout, rx_timeout, this);
+    }
+}
+
+/**
+ * @brief Sets a LoRa interrupt flag, unless it is masked.
+ */
+void SimRadio::lora_irq(uint8_t flag)
+{
+    if (!(_lora[LORA_IRQ_MASK] & flag))
+        _lora[LORA_IRQ_FLAGS] |= flag;
+}
+
+void SimRadio::tx_done(void *arg)
+{
+    SimRadio *radio = (SimRadio *)arg;
+    if (radio->lora())
+        radio->lora_irq(LORA_IRQ_TX_DONE);
+    else
+        radio->_fsk[FSK_IRQ_FLAGS2] |= FSK_IRQ2_PACKET_SENT;
+    radio->_fsk_fifo_len = radio->_fsk_fifo_pos = 0;
+    radio->enter(MODE_STANDBY);
+    radio->update_dio();
+}
+
+void SimRadio::rx_done(void *arg)
+{
+    SimRadio *radio = (SimRadio *)arg;
+    const SimDownlink &rx = radio->_rx;
+    radio->_downlinks++;
+    if (radio->lora())
+    {
+        uint8_t base = radio->_lora[LORA_FIFO_RX_BASE];
+        for (uint8_t i = 0; i < rx.len; i++)
+            radio->_fifo[(uint8_t)(base + i)] = rx.data[i];
+        radio->_lora[LORA_FIFO_RX_CURRENT] = base;
+        radio->_lora[LORA_RX_NB_BYTES] = rx.len;
+        radio->_lora[LORA_PKT_SNR] = (uint8_t)(int8_t)lround(rx.snr * 4);
+        // Below the noise floor, the packet RSSI is read with the SNR added
+        int value = rx.rssi + RSSI_OFFSET_HF - (rx.snr < 0 ? (int)lround(rx.snr) : 0);
+        radio->_lora[LORA_PKT_RSSI] = (uint8_t)constrain(value, 0, 255);
+        radio->lora_irq(LORA_IRQ_RX_DONE);
+        if (radio->mode() == MODE_RX_SINGLE)
+            radio->enter(MODE_STANDBY);
+    }
+    else
+    {
+        memcpy(radio->_fsk_fifo, rx.data, rx.len < SIM_RADIO_FSK_FIFO ? rx.len : SIM_RADIO_FSK_FIFO);
+        radio->_fsk_fifo_len = rx.len;
+        radio->_fsk_fifo_pos = 0;
+        radio->_fsk[FSK_PAYLOAD_LENGTH] = rx.len;
+        radio->_fsk[FSK_IRQ_FLAGS2] |= FSK_IRQ2_PAYLOAD_READY | FSK_IRQ2_CRC_OK;
+    }
+    radio->update_dio();
+}
+
+void SimRadio::rx_timeout(void *arg)
+{
+    SimRadio *radio = (SimRadio *)arg;
+    if (radio->lora())
+    {
+        radio->lora_irq(LORA_IRQ_RX_TIMEOUT);
+        radio->enter(MODE_STANDBY);
+    }
+    else
+    {
+        // The FSK receiver keeps running, the MCU stops it
+        radio->_fsk[FSK_IRQ_FLAGS1] |= FSK_IRQ1_TIMEOUT;
+    }
+    radio->update_dio();
+}
+
+/**
+ * @brief Drives the DIO lines from the interrupt flags, as mapped by RegDioMapping1.
+ */
+void SimRadio::update_dio(void)
+{
+    static const uint32_t pins[3] = {SIM_RADIO_DIO0, SIM_RADIO_DIO1, SIM_RADIO_DIO2};
+    uint8_t map = _fsk[REG_DIO_MAPPING1];
+    int dio[3] = {LOW, LOW, LOW};
+
+    if (lora())
+    {
+        uint8_t flags = _lora[LORA_IRQ_FLAGS];
+        switch (map >> 6)
+        {
+        case 0:
+            dio[0] = (flags & LORA_IRQ_RX_DONE) != 0;
+            break;
+        case 1:
+            dio[0] = (flags & LORA_IRQ_TX_DONE) != 0;
+            break;
+        }
+        if (((map >> 4) & 0x03) == 0)
+            dio[1] = (flags & LORA_IRQ_RX_TIMEOUT) != 0;
+    }
+    else
+    {
+        uint8_t flags1 = _fsk[FSK_IRQ_FLAGS1];
+        uint8_t flags2 = _fsk[FSK_IRQ_FLAGS2];
+        if ((map >> 6) == 0)
+            dio[0] = (flags2 & (mode() == MODE_TX ? FSK_IRQ2_PACKET_SENT : FSK_IRQ2_PAYLOAD_READY)) != 0;
+        if (((map >> 2) & 0x03) == 2 && mode() != MODE_TX)
+            dio[2] = (flags1 & FSK_IRQ1_TIMEOUT) != 0;
+    }
+
+    for (int i = 0; i < 3; i++)
+        if (dio[i] != _dio[i])
+        {
+            _dio[i] = dio[i];
+            sim_pin_drive(pins[i], dio[i]);
+        }
+}
+
+double SimRadio::frequency(void) const
+{
+    uint32_t frf = ((uint32_t)_fsk[REG_FRF_MSB] << 16) | (_fsk[REG_FRF_MID] << 8) | _fsk[REG_FRF_LSB];
+    return frf * SIM_RADIO_XOSC / (1 << 19);
+}
+
+/**
+ * @brief Returns the LoRa symbol time of the current modem settings.
+ */
+double SimRadio::lora_symbol_us(void) const
+{
+    static const double bandwidths[] = {7.8e3, 10.4e3, 15.6e3, 20.8e3, 31.25e3,
+                                        41.7e3, 62.5e3, 125e3, 250e3, 500e3};
+    unsigned bw = _lora[LORA_MODEM_CONFIG1] >> 4;
+    unsigned sf = constrain(_lora[LORA_MODEM_CONFIG2] >> 4, 6, 12);
+    return (1 << sf) * 1e6 / bandwidths[bw < 10 ? bw : 9];
+}
+
+/**
+ * @brief Returns the airtime of a LoRa frame, SX1276 datasheet section 4.1.1.7.
+ *
+ * @param len Payload length in bytes.
+ */
+simtime_t SimRadio::lora_airtime(uint8_t len) const
+{
+    int sf = constrain(_lora[LORA_MODEM_CONFIG2] >> 4, 6, 12);
+    int cr = (_lora[LORA_MODEM_CONFIG1] >> 1) & 0x07;
+    int ih = _lora[LORA_MODEM_CONFIG1] & 0x01;
+    int crc = (_lora[LORA_MODEM_CONFIG2] >> 2) & 0x01;
+    int de = (_lora[LORA_MODEM_CONFIG3] >> 3) & 0x01;
+    int preamble = (_lora[LORA_PREAMBLE_MSB] << 8) | _lora[LORA_PREAMBLE_LSB];
+
+    int num = 8 * len - 4 * sf + 28 + 16 * crc - 20 * ih;
+    int den = 4 * (sf - 2 * de);
+    int payload = 8 + (num > 0 ? (num + den - 1) / den * (cr + 4) : 0);
+    return (simtime_t)((preamble + 4.25 + payload) * lora_symbol_us());
+}
+
+/**
+ * @brief Returns the airtime of an FSK packet: preamble, sync word, length, payload, CRC.
+ *
+ * @param len Payload length in bytes.
+ */
+simtime_t SimRadio::fsk_airtime(uint8_t len) const
+{
+    unsigned bitrate_div = (_fsk[FSK_BITRATE_MSB] << 8) | _fsk[FSK_BITRATE_LSB];
+    unsigned bytes = ((_fsk[FSK_PREAMBLE_MSB] << 8) | _fsk[FSK_PREAMBLE_LSB]) + 1 + len;
+    if (_fsk[FSK_SYNC_CONFIG] & 0x10)
+        bytes += (_fsk[FSK_SYNC_CONFIG] & 0x07) + 1;
+    if (_fsk[FSK_PACKET_CONFIG1] & 0x10)
+        bytes += 2;
+    return (simtime_t)(8.0 * bytes * bitrate_div * 1e6 / SIM_RADIO_XOSC);
+}
+
+/**
+ * @brief Removes and returns the oldest injected downlink that is due.
+ */
+const SimDownlink *SimRadio::take_downlink(void)
+{
+    static SimDownlink dl;
+    for (int i = 0; i < sim_downlink_count; i++)
+        if (sim_downlinks[i].at <= sim_now())
+        {
+            dl = sim_downlinks[i];
+            memmove(&sim_downlinks[i], &sim_downlinks[i + 1],
+                    (--sim_downlink_count - i) * sizeof(SimDownlink));
+            return &dl;
+        }
+    return nullptr;
+}
+
+/**
+ * @brief Prints the radio-on time, in total and per uplink.
+ */
+void SimRadio::report(void)
+{
+    enter(mode());
+    simtime_t tx = 0;
+    for (int sf = 0; sf < 13; sf++)
+        tx += _tx_us[sf];
+    if (_uplinks && tx + _rx_us - _uplink_start_on > _uplink_max_us)
+        _uplink_max_us = tx + _rx_us - _uplink_start_on;
+
+    fprintf(stderr, "\nRadio: %lu uplinks, %lu downlinks\n", (unsigned long)_uplinks,
+            (unsigned long)_downlinks);
+    fprintf(stderr, "  tx     %12.3f s", tx / 1e6);
+    if (_tx_us[0])
+        fprintf(stderr, "  FSK %.3f s", _tx_us[0] / 1e6);
+    for (int sf = 6; sf < 13; sf++)
+        if (_tx_us[sf])
+            fprintf(stderr, "  SF%d %.3f s", sf, _tx_us[sf] / 1e6);
+    fprintf(stderr, "\n  rx     %12.3f s\n", _rx_us / 1e6);
+    if (_uplinks)
+        fprintf(stderr, "  on per uplink %.1f ms, max %.1f ms\n", (tx + _rx_us) / 1e3 / _uplinks,
+                _uplink_max_us / 1e3);
+}
+
+static void sim_radio_report(void)
+{
+    sim_radio.report();
+}
+
+static void sim_radio_rst(uint32_t pin, int level)
+{
+    (void)pin;
+    if (level == LOW)
+        sim_radio.reset();
+}
+
+/**
+ * @brief Queues a downlink, received in the first receive window opening after a time.
+ *
+ * @param at_s Time in seconds.
+ * @param hex PHY payload in hexadecimal.
+ * @param rssi Signal strength in dBm.
+ * @param snr Signal to noise ratio in dB.
+ * @return false if the payload is not valid hexadecimal or the queue is full.
+ */
+bool sim_radio_downlink(double at_s, const char *hex, int rssi, double snr)
+{
+    size_t digits = strlen(hex);
+    if (sim_downlink_count == SIM_RADIO_DOWNLINKS || digits == 0 || digits % 2 ||
+        digits / 2 > sizeof(sim_downlinks[0].data))
+        return false;
+
+    SimDownlink *dl = &sim_downlinks[sim_downlink_count];
+    for (size_t i = 0; i < digits / 2; i++)
+    {
+        unsigned byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1)
+            return false;
+        dl->data[i] = byte;
+    }
+    dl->at = (simtime_t)(at_s * 1e6);
+    dl->len = digits / 2;
+    dl->rssi = rssi;
+    dl->snr = snr;
+    sim_downlink_count++;
+    return true;
+}
+
+/**
+ * @brief Connects the radio to the SPI bus and to its reset line.
+ */
+void sim_radio_init(void)
+{
+    sim_radio.reset();
+    sim_spi_attach(SIM_RADIO_NSS, &sim_radio);
+    // NRESET has a pull-up inside the radio, driving it low resets the radio
+    sim_pin_drive(SIM_RADIO_RST, HIGH);
+    sim_pin_watch(SIM_RADIO_RST, sim_radio_rst);
+    sim_on_exit(sim_radio_report);
+}
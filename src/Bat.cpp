@@ -1,29 +1,73 @@
 #include <Arduino.h>
+#include <lmic.h>
 #include "Bat.h"
 #include "config.h"
+#include "meter.h"
+#include "timebase.h"
+
+/*
+ * Battery voltage measurement.
+ *
+ * A measurement converts the battery divider (ADC_IN14) and VREFINT once each, with
+ * 64x hardware oversampling, from the ADC interrupt. VDDA is derived from VREFINT and
+ * its factory calibration, so the result is in true millivolts even when the regulator
+ * drops out on a low battery. The ADC is only initialized for a measurement, powers
+ * itself off between conversions and is de-initialized once it is done.
+ *
+ * Measurements are started on demand by bat_measure() and every BAT_PERIOD_S seconds by
+ * bat_loop(), which also completes them.
+ */
+
+// Battery divider ratio and VDDA of the VREFINT factory calibration
+static const uint32_t BAT_DIVIDER = 2;
+static const uint32_t BAT_VREFINT_CAL_MV = 3000;
+// 64 samples shifted right by 2: 16-bit results, 16 times the 12-bit scale
+static const uint32_t BAT_OVERSAMPLING = 16;
+static const uint32_t BAT_FULL_SCALE = 4096 * BAT_OVERSAMPLING;
+
+// Open circuit voltage of a LiPo cell against its state of charge, by ascending voltage
+static const struct
+{
+    uint16_t mv;
+    uint8_t soc;
+} BAT_SOC_CURVE[] = {
+    {3300, 0}, {3500, 5}, {3600, 10}, {3650, 18}, {3700, 30}, {3750, 42},
+    {3800, 52}, {3900, 67}, {4000, 79}, {4100, 90}, {4200, 100},
+};
+static const uint8_t BAT_SOC_POINTS = sizeof(BAT_SOC_CURVE) / sizeof(BAT_SOC_CURVE[0]);
+
 ADC_HandleTypeDef hadc;
-uint32_t Volt = 0;
+// Conversions in scan order: battery divider (channel 14), then VREFINT (channel 17)
+static volatile uint16_t bat_raw[2];
+static volatile uint8_t bat_rank = 0;
+static bool bat_running = false;
+static bool bat_valid = false;
+static uint32_t bat_started_at;
+static uint16_t bat_last_mv = 0;
 
 /**
- * @brief Initializes the ADC hardware for battery voltage measurement.
+ * @brief Initializes the ADC hardware for one battery voltage measurement.
  *
- * This function configures the ADC (Analog-to-Digital Converter) settings,
- * including clock prescaler, resolution, sampling time, conversion modes,
- * and more. It enables the GPIOC clock, initializes the ADC instance, and
- * sets up the ADC channel. It also starts ADC calibration.
+ * This function configures the ADC (Analog-to-Digital Converter) settings: single
+ * software triggered scan of the battery divider and VREFINT with 64x oversampling, the
+ * 10 us sampling time VREFINT needs, and auto power off between conversions. It
+ * initializes the ADC instance, sets up both channels and runs the ADC calibration.
  */
 static void MX_ADC_Init(void)
 {
     ADC_ChannelConfTypeDef sConfig = {0};
     __HAL_RCC_GPIOC_CLK_ENABLE();
     hadc.Instance = ADC1;
-    hadc.Init.OversamplingMode = DISABLE;
+    hadc.Init.OversamplingMode = ENABLE;
+    hadc.Init.Oversample.Ratio = ADC_OVERSAMPLING_RATIO_64;
+    hadc.Init.Oversample.RightBitShift = ADC_RIGHTBITSHIFT_2;
+    hadc.Init.Oversample.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
     hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV2;
     hadc.Init.Resolution = ADC_RESOLUTION_12B;
-    hadc.Init.SamplingTime = ADC_SAMPLETIME_39CYCLES_5;
+    hadc.Init.SamplingTime = ADC_SAMPLETIME_160CYCLES_5;
     hadc.Init.ScanConvMode = ADC_SCAN_DIRECTION_FORWARD;
     hadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
-    hadc.Init.ContinuousConvMode = ENABLE;
+    hadc.Init.ContinuousConvMode = DISABLE;
     hadc.Init.DiscontinuousConvMode = DISABLE;
     hadc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
     hadc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
@@ -32,7 +76,7 @@ static void MX_ADC_Init(void)
     hadc.Init.Overrun = ADC_OVR_DATA_PRESERVED;
     hadc.Init.LowPowerAutoWait = DISABLE;
     hadc.Init.LowPowerFrequencyMode = DISABLE;
-    hadc.Init.LowPowerAutoPowerOff = DISABLE;
+    hadc.Init.LowPowerAutoPowerOff = ENABLE;
     if (HAL_ADC_Init(&hadc) != HAL_OK)
     {
         Error_Handler();
@@ -43,52 +87,154 @@ static void MX_ADC_Init(void)
     {
         Error_Handler();
     }
+    // Also enables VREFINT
+    sConfig.Channel = ADC_CHANNEL_VREFINT;
+    if (HAL_ADC_ConfigChannel(&hadc, &sConfig) != HAL_OK)
+    {
+        Error_Handler();
+    }
     HAL_ADCEx_Calibration_Start(&hadc, ADC_SINGLE_ENDED);
 }
 
+/**
+ * @brief ADC interrupt handler.
+ */
+extern "C" void ADC1_COMP_IRQHandler(void)
+{
+    HAL_ADC_IRQHandler(&hadc);
+}
+
+/**
+ * @brief Stores each conversion of the scan, called from the ADC interrupt.
+ */
+extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *h)
+{
+    uint32_t value = HAL_ADC_GetValue(h);
+    if (bat_rank < 2)
+        bat_raw[bat_rank++] = value;
+}
+
+/**
+ * @brief Powers the ADC down after a measurement.
+ */
+static void bat_stop(void)
+{
+    HAL_NVIC_DisableIRQ(ADC1_COMP_IRQn);
+    HAL_ADC_Stop_IT(&hadc);
+    HAL_ADC_DeInit(&hadc);
+    bat_running = false;
+    meter_set(METER_ADC_OFF);
+}
+
 /**
  * @brief Initializes the battery voltage measurement system.
  *
- * This function calls the ADC initialization function and starts the ADC
- * for continuous voltage measurement.
+ * This function starts a measurement right away, the following ones are started by
+ * bat_loop(). The last result is kept across Board_Sleep().
  */
 void bat_init(void)
 {
-    MX_ADC_Init();
-    HAL_ADC_Start(&hadc);
+    bat_measure();
 }
 
 /**
  * @brief Puts the battery voltage measurement system into sleep mode.
  *
- * This function stops the ADC and deinitializes it to reduce power consumption.
+ * This function aborts a measurement in progress. The last result is kept.
  */
 void bat_sleep(void)
 {
-    HAL_ADC_Stop(&hadc);
-    HAL_ADC_DeInit(&hadc);
+    if (bat_running)
+        bat_stop();
 }
 
 /**
- * @brief Continuously measures and updates the battery voltage.
+ * @brief Starts a battery voltage measurement, unless one is in progress.
  *
- * This function accumulates ADC readings, averages them over 20 samples, and
- * updates the global variable `Volt` with the averaged value. This process
- * helps in smoothing out noise in the ADC readings.
+ * The conversions complete from the ADC interrupt within a few ms, bat_loop() then
+ * updates bat_mv(). The MCU must not enter STOP mode meanwhile, see bat_busy().
+ */
+void bat_measure(void)
+{
+    if (bat_running)
+        return;
+
+    MX_ADC_Init();
+    bat_rank = 0;
+    bat_running = true;
+    bat_started_at = timebase_ticks();
+    meter_set(METER_ADC_ON);
+    HAL_NVIC_SetPriority(ADC1_COMP_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(ADC1_COMP_IRQn);
+    if (HAL_ADC_Start_IT(&hadc) != HAL_OK)
+        bat_stop();
+}
+
+/**
+ * @brief Tells whether a measurement is in progress.
+ *
+ * @return true while the ADC converts, it needs the MCU out of STOP mode.
+ */
+bool bat_busy(void)
+{
+    return bat_running;
+}
+
+/**
+ * @brief Completes the measurements and starts a new one every BAT_PERIOD_S seconds.
+ *
+ * VDDA = 3.0 V * VREFINT_CAL / VREFINT, then the battery voltage follows from the
+ * divider conversion against VDDA.
  */
 void bat_loop(void)
 {
-    static uint32_t vot;
-    static uint8_t i;
-    if (i < 20)
+    if (bat_running && bat_rank == 2)
     {
-        i++;
-        vot += HAL_ADC_GetValue(&hadc);
+        bat_stop();
+        uint32_t vref = bat_raw[1];
+        if (vref != 0)
+        {
+            uint32_t vdda_mv = BAT_VREFINT_CAL_MV * *VREFINT_CAL_ADDR * BAT_OVERSAMPLING / vref;
+            bat_last_mv = (uint32_t)bat_raw[0] * vdda_mv * BAT_DIVIDER / BAT_FULL_SCALE;
+            bat_valid = true;
+        }
     }
-    else
+
+    if (!bat_running && (uint32_t)(timebase_ticks() - bat_started_at) >= sec2osticks(BAT_PERIOD_S))
+        bat_measure();
+}
+
+/**
+ * @brief Returns the last measured battery voltage.
+ *
+ * @return The battery voltage in mV, 0 before the first measurement completes.
+ */
+uint16_t bat_mv(void)
+{
+    return bat_valid ? bat_last_mv : 0;
+}
+
+/**
+ * @brief Estimates the state of charge from the last battery voltage.
+ *
+ * Interpolates the open circuit voltage curve of a LiPo cell, so the estimate is only
+ * meaningful for a battery at rest (the radio and GPS loads lower its voltage).
+ *
+ * @return The state of charge in percent.
+ */
+uint8_t bat_soc(void)
+{
+    uint16_t mv = bat_mv();
+    if (mv <= BAT_SOC_CURVE[0].mv)
+        return 0;
+    for (uint8_t i = 1; i < BAT_SOC_POINTS; i++)
     {
-        Volt = vot / i;
-        vot = 0;
-        i = 0;
+        if (mv < BAT_SOC_CURVE[i].mv)
+        {
+            uint32_t span = BAT_SOC_CURVE[i].mv - BAT_SOC_CURVE[i - 1].mv;
+            uint32_t rise = BAT_SOC_CURVE[i].soc - BAT_SOC_CURVE[i - 1].soc;
+            return BAT_SOC_CURVE[i - 1].soc + (mv - BAT_SOC_CURVE[i - 1].mv) * rise / span;
+        }
     }
-}
\ No newline at end of file
+    return 100;
+}
@@ -1,4 +1,3 @@
-
 #ifndef __BAT_H__
 #define __BAT_H__
 
@@ -6,9 +5,15 @@
 #include "stm32l0xx_hal.h"
 #include "stm32_def.h"
 
+// Period of the battery voltage measurements
+#define BAT_PERIOD_S 60
+
 void bat_init(void);
 void bat_loop(void);
 void bat_sleep(void);
-extern uint32_t Volt;
+void bat_measure(void);
+bool bat_busy(void);
+uint16_t bat_mv(void);
+uint8_t bat_soc(void);
 
-#endif /* __BAT_H__ */
\ No newline at end of file
+#endif /* __BAT_H__ */
@@ -0,0 +1,132 @@
+#include <Arduino.h>
+#include <lmic.h>
+#include "adr.h"
+#include "trace.h"
+
+/*
+ * Data rate and TX power control.
+ *
+ * The network drives ADR through LinkADRReq. On top of it, the device asks for a
+ * LinkCheck every ADR_LINKCHECK_PERIOD uplinks and steps one data rate (or 2 dB of
+ * power at the fastest data rate) at a time from the reported margin. The SNR of any
+ * downlink is also checked, a link below the floor steps the data rate down right away.
+ * When the network changes the data rate itself, its choice is kept.
+ */
+
+// EU868 demodulation floor per data rate (DR0 = SF12 ... DR5 = SF7), in dB
+static const int8_t adr_snr_floor[] = {-20, -17, -15, -12, -10, -7};
+
+static uint8_t adr_uplinks = 0;
+static uint8_t adr_missed = 0;
+static bool adr_check_pending = false;
+static uint8_t adr_dr;
+static int8_t adr_txpow;
+
+/**
+ * @brief Applies a new data rate and TX power.
+ */
+static void adr_set(uint8_t dr, int8_t txpow)
+{
+    trace(TRACE_ADR_SET, LMIC.datarate, dr, txpow);
+    LMIC_setDrTxpow(dr, txpow);
+    adr_dr = dr;
+    adr_txpow = txpow;
+    // Verify the new setting sooner
+    adr_uplinks = ADR_LINKCHECK_PERIOD / 2;
+}
+
+/**
+ * @brief Makes the link more robust: more power first, then a slower data rate.
+ */
+static void adr_step_down(void)
+{
+    if (adr_txpow < ADR_TXPOW_MAX)
+        adr_set(adr_dr, ADR_TXPOW_MAX);
+    else if (adr_dr > DR_SF12)
+        adr_set(adr_dr - 1, adr_txpow);
+}
+
+/**
+ * @brief Makes the link cheaper: a faster data rate first, then less power.
+ */
+static void adr_step_up(void)
+{
+    if (adr_dr < DR_SF7)
+        adr_set(adr_dr + 1, adr_txpow);
+    else if (adr_txpow > ADR_TXPOW_MIN)
+        adr_set(adr_dr, adr_txpow - 2 < ADR_TXPOW_MIN ? ADR_TXPOW_MIN : adr_txpow - 2);
+}
+
+/**
+ * @brief Enables ADR, to be called once the session is established.
+ *
+ * Also enables the ADRACKReq mechanism, which lowers the data rate when the network
+ * stops answering.
+ */
+void adr_init(void)
+{
+    LMIC_setAdrMode(1);
+    LMIC_setLinkCheckMode(1);
+    adr_dr = LMIC.datarate;
+    adr_txpow = LMIC.adrTxPow;
+    adr_uplinks = 0;
+    adr_missed = 0;
+    adr_check_pending = false;
+}
+
+/**
+ * @brief Updates the data rate policy after an uplink.
+ *
+ * Must be called on EV_TXCOMPLETE.
+ */
+void adr_update(void)
+{
+    // The network (LinkADRReq) or the ADRACKReq backoff changed the settings
+    if (LMIC.datarate != adr_dr || LMIC.adrTxPow != adr_txpow)
+    {
+        adr_dr = LMIC.datarate;
+        adr_txpow = LMIC.adrTxPow;
+        adr_missed = 0;
+    }
+
+    if (LMIC.txrxFlags & (TXRX_DNW1 | TXRX_DNW2))
+    {
+        // RX1 uses the uplink data rate lowered by the RX1 offset (the LMIC stores it
+        // in dndr when it sets the window up), RX2 a fixed one
+        int dr = (LMIC.txrxFlags & TXRX_DNW1) ? LMIC.dndr : LMIC.dn2Dr;
+        dr = dr < DR_SF12 ? DR_SF12 : (dr > DR_SF7 ? DR_SF7 : dr);
+        int margin = LMIC.snr / SNR_SCALEUP - adr_snr_floor[dr];
+        trace(TRACE_ADR_DOWNLINK, LMIC.rssi - RSSI_OFF, LMIC.snr / SNR_SCALEUP, margin);
+        // A LinkCheck answer in this downlink takes precedence
+        if (margin < 0 && !(adr_check_pending && LMIC.linkCheckGwCnt))
+            adr_step_down();
+    }
+
+    if (adr_check_pending)
+    {
+        adr_check_pending = false;
+        if (LMIC.linkCheckGwCnt)
+        {
+            int margin = LMIC.linkCheckMargin - ADR_INSTALL_MARGIN;
+            trace(TRACE_LINKCHECK, LMIC.linkCheckMargin, LMIC.linkCheckGwCnt);
+            adr_missed = 0;
+            if (margin < 0)
+                adr_step_down();
+            else if (margin >= ADR_STEP_MARGIN)
+                adr_step_up();
+        }
+        else if (++adr_missed >= ADR_LINKCHECK_MISSED)
+        {
+            trace(TRACE_LINKCHECK_NONE);
+            adr_missed = 0;
+            adr_step_down();
+        }
+    }
+
+    if (++adr_uplinks >= ADR_LINKCHECK_PERIOD)
+    {
+        adr_uplinks = 0;
+        adr_check_pending = true;
+        LMIC_requestLinkCheck();
+    }
+}
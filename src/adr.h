@@ -0,0 +1,19 @@
+#ifndef __ADR_H__
+#define __ADR_H__
+
+// Link margin kept above the demodulation floor, in dB
+#define ADR_INSTALL_MARGIN 10
+// Extra margin needed to step the data rate up or the power down, in dB
+#define ADR_STEP_MARGIN 3
+// Uplinks between LinkCheck requests
+#define ADR_LINKCHECK_PERIOD 16
+// Unanswered LinkCheck requests before stepping the data rate down
+#define ADR_LINKCHECK_MISSED 2
+// TX power range in dBm
+#define ADR_TXPOW_MAX 14
+#define ADR_TXPOW_MIN 2
+
+void adr_init(void);
+void adr_update(void);
+
+#endif /* __ADR_H__ */
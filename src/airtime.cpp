@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include <lmic.h>
+#include <STM32RTC.h>
+#include "airtime.h"
+
+/*
+ * Uplink airtime accounting and scheduling.
+ *
+ * The airtime of every frame sent (joins included) is added to hourly buckets covering
+ * the last 24 h, timed by the RTC so the STOP mode periods are counted. The next uplink
+ * is delayed as needed by the EU868 band duty cycle (LMIC.bands[].avail) and by the TTN
+ * daily budget, so that LMIC never has to hold a frame back.
+ */
+
+#define AIRTIME_BUCKETS 24
+#define AIRTIME_BUCKET_S 3600
+#define AIRTIME_WINDOW_S (AIRTIME_BUCKETS * AIRTIME_BUCKET_S)
+// MHDR, FHDR without options, FPort and MIC
+#define AIRTIME_LORAWAN_OVERHEAD 13
+
+static uint32_t bucket_ms[AIRTIME_BUCKETS];
+static uint32_t bucket_hour[AIRTIME_BUCKETS];
+
+/**
+ * @brief Returns the current hour, counted from the RTC epoch.
+ */
+static uint32_t airtime_hour(void)
+{
+    return STM32RTC::getInstance().getEpoch() / AIRTIME_BUCKET_S;
+}
+
+/**
+ * @brief Converts LMIC ticks to milliseconds, rounding up.
+ */
+static uint32_t airtime_ms(ostime_t ticks)
+{
+    return (uint32_t)(((uint64_t)ticks * 1000 + OSTICKS_PER_SEC - 1) / OSTICKS_PER_SEC);
+}
+
+/**
+ * @brief Adds the frame being sent to the airtime used.
+ *
+ * Must be called on EV_TXSTART, when LMIC.rps and LMIC.dataLen describe the frame.
+ */
+void airtime_record(void)
+{
+    uint32_t hour = airtime_hour();
+    int i = hour % AIRTIME_BUCKETS;
+
+    if (bucket_hour[i] != hour)
+    {
+        bucket_hour[i] = hour;
+        bucket_ms[i] = 0;
+    }
+    bucket_ms[i] += airtime_ms(calcAirTime(LMIC.rps, LMIC.dataLen));
+}
+
+/**
+ * @brief Returns the airtime left in the TTN daily budget.
+ *
+ * @return The airtime in milliseconds that can still be used over the last 24 h.
+ */
+uint32_t airtime_budget_left(void)
+{
+    uint32_t hour = airtime_hour();
+    uint32_t used = 0;
+
+    for (int i = 0; i < AIRTIME_BUCKETS; i++)
+        if (hour - bucket_hour[i] < AIRTIME_BUCKETS)
+            used += bucket_ms[i];
+    return used >= AIRTIME_DAILY_BUDGET_MS ? 0 : AIRTIME_DAILY_BUDGET_MS - used;
+}
+
+/**
+ * @brief Returns the time until a band usable at the current data rate is free.
+ *
+ * @return The wait in seconds, 0 if a band is available now.
+ */
+static unsigned airtime_band_wait(void)
+{
+    ostime_t now = os_getTime();
+    s4_t wait = -1;
+
+    for (u1_t ch = 0; ch < MAX_CHANNELS; ch++)
+    {
+        if (!(LMIC.channelMap & (1 << ch)) || !(LMIC.channelDrMap[ch] & (1 << LMIC.datarate)))
+            continue;
+        s4_t band_wait = LMIC.bands[LMIC.channelFreq[ch] & 0x3].avail - now;
+        if (wait < 0 || band_wait < wait)
+            wait = band_wait;
+    }
+    return wait > 0 ? (unsigned)((wait + OSTICKS_PER_SEC - 1) / OSTICKS_PER_SEC) : 0;
+}
+
+/**
+ * @brief Plans the interval to the next uplink.
+ *
+ * The requested interval is stretched to wait for the duty cycle of the bands, and to
+ * pace the TTN budget: with the full budget no pacing applies, as it is used the pace
+ * grows until, with half the budget left, the remaining airtime is spread over a day.
+ *
+ * @param interval The requested interval in seconds.
+ * @param payload_len The application payload size of the next uplink.
+ * @return The interval in seconds, at most AIRTIME_MAX_INTERVAL.
+ */
+unsigned airtime_next_interval(unsigned interval, uint8_t payload_len)
+{
+    uint32_t frame_ms = airtime_ms(calcAirTime(updr2rps(LMIC.datarate), payload_len + AIRTIME_LORAWAN_OVERHEAD));
+    uint32_t left = airtime_budget_left();
+    unsigned band_wait = airtime_band_wait();
+
+    if (band_wait > interval)
+        interval = band_wait;
+
+    if (left <= frame_ms)
+        return AIRTIME_MAX_INTERVAL;
+
+    float used = 1.0f - (float)left / AIRTIME_DAILY_BUDGET_MS;
+    float pacing = used >= 0.5f ? 1.0f : 2 * used;
+    float pace = pacing * frame_ms * AIRTIME_WINDOW_S / left;
+    if (pace > interval)
+        interval = (unsigned)pace;
+
+    return interval > AIRTIME_MAX_INTERVAL ? AIRTIME_MAX_INTERVAL : interval;
+}
@@ -0,0 +1,15 @@
+#ifndef __AIRTIME_H__
+#define __AIRTIME_H__
+
+#include <stdint.h>
+
+// TTN fair use policy: 30 s of uplink airtime per device over 24 h
+#define AIRTIME_DAILY_BUDGET_MS 30000
+// Longest interval the scheduler stretches an uplink to
+#define AIRTIME_MAX_INTERVAL 3600
+
+void airtime_record(void);
+uint32_t airtime_budget_left(void);
+unsigned airtime_next_interval(unsigned interval, uint8_t payload_len);
+
+#endif /* __AIRTIME_H__ */
@@ -4,10 +4,22 @@
 #include "config.h"
 #include "Bat.h"
 #include "loramac.h"
+#include "touch.h"
+#include "meter.h"
+#include "trace.h"
+#include "ui.h"
+#include "motion.h"
+#include "timebase.h"
+#include <lmic.h>
 #include <SPI.h>
 #include <Wire.h>
 #include "STM32LowPower.h"
 
+// Time base when BoardInit() started, until Board_BootDone() reports the boot time
+static uint32_t board_boot_ticks;
+static bool board_booting = false;
+static bool board_lmic_started = false;
+
 /**
  * @brief Initializes the LoRaWAN communication interface.
  *
@@ -29,13 +41,28 @@ void LoraWanInit(void)
     digitalWrite(GPS_EN, HIGH);
 }
 
+/**
+ * @brief Reports a GPS module that stopped answering commands.
+ *
+ * The GPS module released its serial port; it is restarted from a reset on the next
+ * gps_init().
+ *
+ * @param cmd The command that was not acknowledged.
+ */
+static void GpsFailure(const char *cmd)
+{
+    Serial.printf("GPS not answering %s\n", cmd);
+}
+
 /**
  * @brief Initializes the board and its peripherals.
  *
  * This function sets up power pins, serial communication, I2C interface,
- * GPS, OLED, battery voltage measurement, and touchpad. It ensures that
+ * motion detection, GPS, OLED, battery voltage measurement, and touchpad. It ensures that
  * all necessary peripherals are configured and initialized properly.
- * It also configures the wakeup interrupt for deep sleep mode.
+ * It also configures the wakeup interrupt for deep sleep mode, starts the energy
+ * accounting once the LSE runs and, on the first call, the LMIC scheduler. Nothing waits here: the splash screen, the GPS
+ * configuration and the LMIC join go on concurrently from loop().
  */
 void BoardInit(void)
 {
@@ -45,23 +72,82 @@ void BoardInit(void)
     digitalWrite(PWR_GPS_PIN, HIGH);
     Serial.begin(115200);
 
+    // RTC wakes the MCU up from Board_Idle(). It also starts the LSE, which clocks the
+    // LPTIM1 time base, so the boot time is measured from here.
+    STM32RTC &rtc = STM32RTC::getInstance();
+    rtc.setClockSource(STM32RTC::LSE_CLOCK);
+    rtc.begin();
+    LowPower.begin();
+    meter_init();
+    board_boot_ticks = timebase_ticks();
+    board_booting = true;
+
+    // Radio SPI, then the LMIC scheduler before any job is armed. It is started once:
+    // os_init() drops the scheduled jobs, the uplink and the ones of the modules below.
+    LoraWanInit();
+    if (!board_lmic_started)
+    {
+        os_init();
+        board_lmic_started = true;
+    }
+
     //I2C for OLED
     Wire.setSCL(IICSCL);
     Wire.setSDA(IICSDA);
     Wire.begin();
+    // Motion detection, the IMU is configured later from the poll job
+    motion_on_change(onMotion);
+    motion_init();
 
+    gps_on_failure(GpsFailure);
+    gps_profile_update(getTXInterval(), getTXFast());
     if (!getDEV_INTERIOR()) gps_init(); //Init only if Dev not in interiors
     oled_init();
+    ui_init();
     bat_init();
     pinMode(BAT_VOLT_PIN, INPUT_ANALOG);
 
-    LoraWanInit();
+    touch_init();
+}
 
-    pinMode(TTP223_VDD_PIN, OUTPUT);
-    pinMode(TOUCH_PAD_PIN, INPUT);
-    digitalWrite(TTP223_VDD_PIN, HIGH);
+/**
+ * @brief Reports the boot time, once the first frame after BoardInit() is sent.
+ *
+ * Called on every TX start. The time runs from the start of the time base in
+ * BoardInit() (after a power up the LSE start-up is not included) to the join request,
+ * or to the first uplink when the session was restored or the board wakes up.
+ */
+void Board_BootDone(void)
+{
+    if (!board_booting)
+        return;
+    board_booting = false;
+    trace(TRACE_BOOT, osticks2ms(timebase_ticks() - board_boot_ticks));
+}
 
-    LowPower.attachInterruptWakeup(TOUCH_PAD_PIN, NULL, RISING, DEEP_SLEEP_MODE);
+/**
+ * @brief Idles the MCU until an interrupt or the RTC alarm wakes it up.
+ *
+ * While the GPS is awake or the battery is being measured the core only sleeps
+ * (peripherals keep running) so no NMEA character or conversion is lost. Otherwise the
+ * MCU enters STOP mode, waking on the touch pad or the LoRa DIO lines and the LPTIM1
+ * time base.
+ *
+ * @param ms Maximum idle time in milliseconds, or 0 to wait for an interrupt.
+ */
+void Board_Idle(uint32_t ms)
+{
+    if (gps_awake() || bat_busy())
+    {
+        meter_set(METER_MCU_SLEEP);
+        LowPower.sleep(ms);
+    }
+    else
+    {
+        meter_set(METER_MCU_STOP);
+        LowPower.deepSleep(ms);
+    }
+    meter_set(METER_MCU_RUN);
 }
 
 /**
@@ -74,7 +160,12 @@ void BoardInit(void)
  */
 void Board_Sleep(void) {
   gps_sleep();
+  // Bounded by the GPS command timeouts and retries
+  while (gps_busy())
+    gps_loop();
   oled_sleep();
+  meter_report();
+  trace_flush();
   Serial.println(F("MCU Sleep"));
   pinMode(PWR_1_8V_PIN, OUTPUT);
   digitalWrite(PWR_1_8V_PIN, LOW);
@@ -82,9 +173,16 @@ void Board_Sleep(void) {
   SPI.end();
   Wire.end();
   bat_sleep();
-  LowPower.deepSleep();
+  // The LPTIM1 time base wakes the MCU every 2 s, only a new touch ends the sleep
+  touch_clear_wakeup();
+  meter_set(METER_MCU_STOP);
+  do
+  {
+    LowPower.deepSleep();
+    meter_update();
+  } while (!touch_wakeup());
+  meter_set(METER_MCU_RUN);
   //After wakeup
   BoardInit();
-  delay(500);
   Serial.println(F("Wakeup"));  
 }
\ No newline at end of file
@@ -1,3 +1,7 @@
+#include <stdint.h>
+
 void Board_Sleep(void);
 void LoraWanInit(void);
-void BoardInit(void);
\ No newline at end of file
+void BoardInit(void);
+void Board_Idle(uint32_t ms);
+void Board_BootDone(void);
\ No newline at end of file
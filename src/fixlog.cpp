@@ -0,0 +1,213 @@
+#include <Arduino.h>
+#include <STM32RTC.h>
+#include "fixlog.h"
+#include "gps.h"
+#include "session.h"
+
+/*
+ * Store-and-forward log of GPS fixes.
+ *
+ * Every fix reported by the GPS is added to a RAM ring. When it is full, the oldest fix
+ * is moved to a ring in the data EEPROM, after the session records, so a long outage
+ * (not joined, dead link) keeps its backlog and it survives a reset. Fixes are read
+ * oldest first: the EEPROM ones, then the RAM ones.
+ *
+ * The GPS reports a fix every position cycle, down to 1 s, and each spill writes four
+ * EEPROM words and blocks for a few ms. Only one fix every FIXLOG_SPILL_S seconds is
+ * spilled, the others leaving the RAM ring are dropped: the backlog older than the RAM
+ * ring is thinned out, and the wear of the ring is bounded whatever the GPS rate.
+ *
+ * An EEPROM slot is pending when its time word is not 0. The time word is written
+ * last when a fix is spilled and cleared when it is sent. The ring keeps at least one
+ * slot free, so after a reset the oldest pending slot is the one after a free slot.
+ */
+
+#define FIXLOG_EEPROM_BASE (DATA_EEPROM_BASE + SESSION_EEPROM_SIZE)
+#define FIXLOG_EEPROM_SLOTS ((DATA_EEPROM_BANK2_END + 1 - FIXLOG_EEPROM_BASE) / sizeof(FixRecord))
+
+static_assert(sizeof(FixRecord) % 4 == 0, "FixRecord must be word aligned");
+
+static FixRecord ram_log[FIXLOG_RAM_SIZE];
+static uint16_t ram_tail = 0;
+static uint16_t ram_count = 0;
+static uint16_t ee_tail = 0;
+static uint16_t ee_count = 0;
+// Time of the last fix spilled, 0 if none
+static uint32_t ee_last_time = 0;
+
+/**
+ * @brief Returns the fix stored in an EEPROM slot, mapped in memory.
+ */
+static const FixRecord *fixlog_slot(uint16_t slot)
+{
+    return (const FixRecord *)(FIXLOG_EEPROM_BASE + slot * sizeof(FixRecord));
+}
+
+/**
+ * @brief Clears the time word of the oldest EEPROM fix, it is no longer pending.
+ */
+static void fixlog_ee_drop(void)
+{
+    HAL_FLASHEx_DATAEEPROM_Unlock();
+    HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD,
+                                   (uintptr_t)&fixlog_slot(ee_tail)->time, 0);
+    HAL_FLASHEx_DATAEEPROM_Lock();
+    ee_tail = (ee_tail + 1) % FIXLOG_EEPROM_SLOTS;
+    ee_count--;
+}
+
+/**
+ * @brief Removes the oldest RAM fix, moving it to the EEPROM ring if the last fix
+ * spilled is at least FIXLOG_SPILL_S seconds older. The oldest EEPROM fix is dropped
+ * if the ring is full.
+ */
+static void fixlog_spill(void)
+{
+    const FixRecord *fix = &ram_log[ram_tail];
+    const uint32_t *words = (const uint32_t *)fix;
+    int32_t spacing = fix->time - ee_last_time;
+
+    // A fix older than the last one spilled (the RTC went back) is spilled
+    if (ee_last_time == 0 || spacing < 0 || spacing >= FIXLOG_SPILL_S)
+    {
+        // The slot before the oldest one is kept free
+        if (ee_count == FIXLOG_EEPROM_SLOTS - 1)
+            fixlog_ee_drop();
+
+        uint32_t addr = (uintptr_t)fixlog_slot((ee_tail + ee_count) % FIXLOG_EEPROM_SLOTS);
+        HAL_FLASHEx_DATAEEPROM_Unlock();
+        // The time word is the last one, it makes the slot pending
+        for (size_t i = 0; i < sizeof(FixRecord) / 4; i++)
+            HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, addr + i * 4, words[i]);
+        HAL_FLASHEx_DATAEEPROM_Lock();
+        ee_count++;
+        ee_last_time = fix->time;
+    }
+
+    ram_tail = (ram_tail + 1) % FIXLOG_RAM_SIZE;
+    ram_count--;
+}
+
+/**
+ * @brief Adds the current GPS fix to the log.
+ */
+static void fixlog_gps_fix(void)
+{
+    if (gps->location.isValid() && gps->altitude.isValid())
+        fixlog_add(gps->location.lat(), gps->location.lng(), gps->altitude.meters());
+}
+
+/**
+ * @brief Restores the fixes spilled to EEPROM and starts logging the GPS fixes.
+ *
+ * The pending EEPROM slots are contiguous in the ring, their first one follows the
+ * free slot.
+ */
+void fixlog_init(void)
+{
+    ee_tail = 0;
+    ee_count = 0;
+    for (uint16_t slot = 0; slot < FIXLOG_EEPROM_SLOTS; slot++)
+    {
+        if (fixlog_slot(slot)->time == 0)
+            continue;
+        if (fixlog_slot((slot + FIXLOG_EEPROM_SLOTS - 1) % FIXLOG_EEPROM_SLOTS)->time == 0)
+            ee_tail = slot;
+        ee_count++;
+    }
+    ee_last_time = ee_count ? fixlog_slot((ee_tail + ee_count - 1) % FIXLOG_EEPROM_SLOTS)->time : 0;
+    if (ee_count)
+        Serial.printf("Fix log: %d fixes restored\n", ee_count);
+
+    gps_on_fix(fixlog_gps_fix);
+}
+
+/**
+ * @brief Returns the time used to stamp the fixes.
+ *
+ * @return The RTC time in seconds.
+ */
+uint32_t fixlog_now(void)
+{
+    uint32_t now = STM32RTC::getInstance().getEpoch();
+    return now ? now : 1;
+}
+
+/**
+ * @brief Returns the age of a fix.
+ *
+ * The RTC starts again from its default date when the board loses power, the fixes
+ * restored from the EEPROM are then in the future: their age is taken as 0.
+ *
+ * @param fix The fix.
+ * @param now The current time, from fixlog_now().
+ * @return The age in seconds.
+ */
+uint32_t fixlog_age(const FixRecord *fix, uint32_t now)
+{
+    return (int32_t)(now - fix->time) > 0 ? now - fix->time : 0;
+}
+
+/**
+ * @brief Adds a fix to the log.
+ *
+ * @param lat Latitude in degrees.
+ * @param lng Longitude in degrees.
+ * @param alt Altitude in meters.
+ */
+void fixlog_add(double lat, double lng, double alt)
+{
+    if (ram_count == FIXLOG_RAM_SIZE)
+        fixlog_spill();
+
+    FixRecord *fix = &ram_log[(ram_tail + ram_count) % FIXLOG_RAM_SIZE];
+    fix->lat = (int32_t)lround(lat * 1e6);
+    fix->lng = (int32_t)lround(lng * 1e6);
+    fix->alt = (int32_t)lround(alt);
+    fix->time = fixlog_now();
+    ram_count++;
+}
+
+/**
+ * @brief Returns the number of fixes waiting to be sent.
+ */
+uint16_t fixlog_count(void)
+{
+    return ee_count + ram_count;
+}
+
+/**
+ * @brief Reads a pending fix.
+ *
+ * @param i Index of the fix, 0 is the oldest.
+ * @param fix Filled with the fix.
+ * @return False if there is no such fix.
+ */
+bool fixlog_get(uint16_t i, FixRecord *fix)
+{
+    if (i < ee_count)
+        *fix = *fixlog_slot((ee_tail + i) % FIXLOG_EEPROM_SLOTS);
+    else if (i - ee_count < ram_count)
+        *fix = ram_log[(ram_tail + i - ee_count) % FIXLOG_RAM_SIZE];
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Removes the oldest fixes, once they have been sent.
+ *
+ * @param n Number of fixes to remove.
+ */
+void fixlog_consume(uint16_t n)
+{
+    while (n && ee_count)
+    {
+        fixlog_ee_drop();
+        n--;
+    }
+    if (n > ram_count)
+        n = ram_count;
+    ram_tail = (ram_tail + n) % FIXLOG_RAM_SIZE;
+    ram_count -= n;
+}
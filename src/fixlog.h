@@ -0,0 +1,31 @@
+#ifndef __FIXLOG_H__
+#define __FIXLOG_H__
+
+#include <stdint.h>
+
+// Fixes kept in RAM, older ones are spilled to the data EEPROM
+#define FIXLOG_RAM_SIZE 32
+
+// Minimum time between two fixes spilled to the data EEPROM, the ones in between are
+// dropped
+#ifndef FIXLOG_SPILL_S
+#define FIXLOG_SPILL_S 60
+#endif
+
+typedef struct
+{
+    int32_t lat;   // Latitude in 1e-6 degrees
+    int32_t lng;   // Longitude in 1e-6 degrees
+    int32_t alt;   // Altitude in meters
+    uint32_t time; // RTC time in seconds, never 0
+} FixRecord;
+
+void fixlog_init(void);
+void fixlog_add(double lat, double lng, double alt);
+uint16_t fixlog_count(void);
+bool fixlog_get(uint16_t i, FixRecord *fix);
+void fixlog_consume(uint16_t n);
+uint32_t fixlog_now(void);
+uint32_t fixlog_age(const FixRecord *fix, uint32_t now);
+
+#endif /* __FIXLOG_H__ */
@@ -1,117 +1,700 @@
 #include <TinyGPS++.h>
+#include <lmic.h>
 #include "config.h"
+#include "gps.h"
+#include "meter.h"
+#include "trace.h"
 
+static TinyGPSPlus gps_parser;
 TinyGPSPlus *gps = nullptr;
-HardwareSerial gpsPort(GPS_RX, GPS_TX);
+/**
+ * @brief GPS serial port, giving access to the HAL handle of the UART for the DMA
+ * reception (the core keeps it protected).
+ */
+class GpsSerial : public HardwareSerial
+{
+public:
+    GpsSerial(uint32_t rx, uint32_t tx) : HardwareSerial(rx, tx) {}
+    UART_HandleTypeDef *handle(void) { return &_serial.handle; }
+};
+
+static GpsSerial gpsPort(GPS_RX, GPS_TX);
 bool GPS_SLEEP_FLAG = true;
 
+// Reset pulse and boot time of the receiver
+static const uint32_t GPS_RESET_MS = 200;
+static const uint32_t GPS_BOOT_MS = 500;
+// Acknowledge timeout of a command and number of times it is re-sent
+static const uint16_t GPS_CMD_TIMEOUT_MS = 500;
+static const uint8_t GPS_CMD_MAX_RETRIES = 5;
+static const uint8_t GPS_CMD_QUEUE_LEN = 8;
+// @BSSL output sentence bits. printVariables() only uses location, altitude and
+// satellites, which GGA carries on its own.
+static const uint16_t GPS_NMEA_GGA = 0x0001;
+static const uint16_t GPS_NMEA_PROFILE = GPS_NMEA_GGA;
+// Position cycle bounds (@GSOP, multiple of 1 s) and fixes wanted per uplink
+static const uint16_t GPS_CYCLE_MIN_MS = 1000;
+static const uint16_t GPS_CYCLE_MAX_MS = 10000;
+static const unsigned GPS_FIXES_PER_TX = 3;
+// Duty cycling: lead time before an uplink when no time to first fix is known yet,
+// margin added to the worst recent one, bounds, and shortest sleep worth a wake up
+static const uint32_t GPS_LEAD_DEFAULT_MS = 10000;
+static const uint32_t GPS_LEAD_MARGIN_MS = 2000;
+static const uint32_t GPS_LEAD_MIN_MS = 3000;
+static const uint32_t GPS_LEAD_MAX_MS = 60000;
+static const uint32_t GPS_SLEEP_MIN_MS = 5000;
+static const uint8_t GPS_TTFF_HISTORY = 4;
+// Size of the DMA ring buffer receiving from the GPS, ~90 ms at 115200 baud
+static const uint16_t GPS_DMA_BUF_LEN = 1024;
+
+enum GpsState
+{
+    GPS_STATE_OFF,
+    GPS_STATE_RESET,
+    GPS_STATE_BOOT,
+    GPS_STATE_READY,
+};
+
+struct GpsCommand
+{
+    const char *cmd;      // Command, e.g. "@GSTP"
+    const char *arg;      // Argument, or nullptr
+    uint16_t timeout_ms;  // Acknowledge timeout
+    void (*done)(void);   // Called once acknowledged, or nullptr
+};
+
+static GpsState gps_state = GPS_STATE_OFF;
+static uint32_t gps_state_since;
+static GpsCommand gps_cmd_queue[GPS_CMD_QUEUE_LEN];
+static uint8_t gps_cmd_head = 0;
+static uint8_t gps_cmd_count = 0;
+static bool gps_cmd_sent;
+static uint8_t gps_cmd_retries;
+static uint32_t gps_cmd_sent_at;
+static bool gps_sleep_pending = false;
+static GpsFailureCallback gps_failure_cb = nullptr;
+static GpsFixCallback gps_fix_cb = nullptr;
+static char gps_line[24];
+static uint8_t gps_line_len = 0;
+static DMA_HandleTypeDef hdma_gps_rx;
+static uint8_t gps_dma_buf[GPS_DMA_BUF_LEN];
+// Half and full transfer events, and characters read, since the reception started
+static volatile uint32_t gps_dma_halves = 0;
+static uint32_t gps_dma_read = 0;
+static uint16_t gps_profile_cycle_ms = GPS_CYCLE_MIN_MS;
+static char gps_bssl_arg[8];
+static char gps_gsop_arg[16];
+static osjob_t gps_wake_job;
+static ostime_t gps_woken_at;
+static bool gps_ttff_pending = false;
+static bool gps_fix_fresh = false;
+static uint32_t gps_fix_count = 0;
+static uint32_t gps_ttff_ms[GPS_TTFF_HISTORY];
+static uint8_t gps_ttff_count = 0;
+static uint8_t gps_ttff_pos = 0;
+
+/**
+ * @brief DMA1 channel 4 to 7 interrupt handler.
+ *
+ * Serves the half and full transfer interrupts of the GPS ring buffer. They wake the
+ * MCU up and are counted, so GPS_DmaRead() can tell how far the DMA went.
+ */
+extern "C" void DMA1_Channel4_5_6_7_IRQHandler(void)
+{
+    if (__HAL_DMA_GET_FLAG(&hdma_gps_rx, DMA_FLAG_HT6))
+        gps_dma_halves++;
+    if (__HAL_DMA_GET_FLAG(&hdma_gps_rx, DMA_FLAG_TC6))
+        gps_dma_halves++;
+    HAL_DMA_IRQHandler(&hdma_gps_rx);
+}
+
+/**
+ * @brief Starts the circular reception to idle into the ring buffer, from its start.
+ */
+static void GPS_DmaReceive(void)
+{
+    gps_dma_halves = 0;
+    gps_dma_read = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(gpsPort.handle(), gps_dma_buf, GPS_DMA_BUF_LEN);
+}
+
+/**
+ * @brief Starts receiving from the GPS into the DMA ring buffer.
+ *
+ * USART4 RX (PC11) is served by DMA1 channel 6 in circular mode instead of one
+ * interrupt per character. Reception to idle makes the UART interrupt fire once the
+ * RX line goes quiet, i.e. once per NMEA burst, so the MCU sleeps while the burst is
+ * received and no character is lost while interrupts are disabled. HardwareSerial is
+ * still used to send commands.
+ *
+ * Called once the module has booted: nothing drains the ring during the reset and
+ * boot, the output of the module up to then is dropped.
+ */
+static void GPS_DmaStart(void)
+{
+    UART_HandleTypeDef *huart = gpsPort.handle();
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdma_gps_rx.Instance = DMA1_Channel6;
+    hdma_gps_rx.Init.Request = DMA_REQUEST_12; // USART4_RX
+    hdma_gps_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_gps_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_gps_rx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_gps_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_gps_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_gps_rx.Init.Mode = DMA_CIRCULAR;
+    hdma_gps_rx.Init.Priority = DMA_PRIORITY_HIGH;
+    if (HAL_DMA_Init(&hdma_gps_rx) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    __HAL_LINKDMA(huart, hdmarx, hdma_gps_rx);
+    HAL_NVIC_SetPriority(DMA1_Channel4_5_6_7_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel4_5_6_7_IRQn);
+
+    // Replace the per character reception started by HardwareSerial::begin()
+    HAL_UART_AbortReceive(huart);
+    GPS_DmaReceive();
+}
+
+/**
+ * @brief Stops the GPS DMA reception, before the serial port is released.
+ */
+static void GPS_DmaStop(void)
+{
+    HAL_UART_AbortReceive(gpsPort.handle());
+    HAL_NVIC_DisableIRQ(DMA1_Channel4_5_6_7_IRQn);
+    HAL_DMA_DeInit(&hdma_gps_rx);
+}
+
 /**
- * @brief Sends a command to the GPS module and waits for an acknowledgment.
+ * @brief Queues a command for the GPS module.
  *
- * This function sends a command to the GPS module through the serial port and waits
- * for an acknowledgment response. It optionally sends an argument with the command.
- * The function continuously checks for the acknowledgment until it receives the expected
- * response.
+ * The command is sent from gps_loop() once all previously queued commands have been
+ * acknowledged. No memory is allocated, cmd and arg must outlive the command (string
+ * literals or static buffers).
  *
  * @param cmd The command to be sent to the GPS module.
  * @param arg An optional argument to be sent with the command.
+ * @param done An optional function called once the command is acknowledged.
+ * @return false if the queue is full.
  */
-void GPS_WaitAck(String cmd, String arg = "")
+static bool GPS_Queue(const char *cmd, const char *arg = nullptr, void (*done)(void) = nullptr)
 {
-    while (1)
+    if (gps_cmd_count == GPS_CMD_QUEUE_LEN)
+        return false;
+
+    GpsCommand &c = gps_cmd_queue[(gps_cmd_head + gps_cmd_count) % GPS_CMD_QUEUE_LEN];
+    c.cmd = cmd;
+    c.arg = arg;
+    c.timeout_ms = GPS_CMD_TIMEOUT_MS;
+    c.done = done;
+    if (gps_cmd_count++ == 0)
     {
-        if (arg != "")
+        gps_cmd_sent = false;
+        gps_cmd_retries = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Drops all queued GPS commands, including the one waiting for its acknowledge.
+ */
+static void GPS_Flush(void)
+{
+    gps_cmd_count = 0;
+    gps_sleep_pending = false;
+}
+
+/**
+ * @brief Releases the GPS serial port once the module sleeps or failed.
+ */
+static void GPS_PortOff(void)
+{
+    GPS_DmaStop();
+    gpsPort.end();
+    gps_state = GPS_STATE_OFF;
+    gps_line_len = 0;
+    GPS_SLEEP_FLAG = true;
+    meter_set(METER_GPS_SLEEP);
+}
+
+/**
+ * @brief Completes the sleep sequence started by gps_sleep().
+ */
+static void GPS_SleepDone(void)
+{
+    gps_sleep_pending = false;
+    trace(TRACE_GPS_SLEEP);
+    GPS_PortOff();
+}
+
+/**
+ * @brief Queues the commands that configure and start positioning.
+ */
+static void GPS_QueueStart(void)
+{
+    snprintf(gps_bssl_arg, sizeof(gps_bssl_arg), "0x%X", GPS_NMEA_PROFILE);
+    snprintf(gps_gsop_arg, sizeof(gps_gsop_arg), "1 %u 0", (unsigned)gps_profile_cycle_ms);
+
+    GPS_Queue("@GSTP"); //Positioning stop
+    GPS_Queue("@BSSL", gps_bssl_arg); //Output sentence select, see gps_profile_update()
+    GPS_Queue("@GSOP", gps_gsop_arg); //Operation mode normal, position cycle, sleep time
+    GPS_Queue("@GNS", "0x03"); // Use the GPS and GLONASS systems.
+    //! Start GPS connamd
+    GPS_Queue("@GSR");
+}
+
+/**
+ * @brief Tells whether a line received from the GPS acknowledges a command.
+ *
+ * The module answers "@GSTP" with "[GSTP] Done".
+ *
+ * @param line The received line, without line terminator.
+ * @param cmd The command waiting for its acknowledge.
+ * @return true if the line is the acknowledge of cmd.
+ */
+static bool GPS_IsAck(const char *line, const char *cmd)
+{
+    size_t len = strlen(cmd + 1);
+    return line[0] == '[' && strncmp(line + 1, cmd + 1, len) == 0 &&
+           strncmp(line + 1 + len, "] Done", 6) == 0;
+}
+
+/**
+ * @brief Sends the command at the head of the queue.
+ */
+static void GPS_Send(const GpsCommand &c)
+{
+    gpsPort.print(c.cmd);
+    if (c.arg != nullptr)
+    {
+        gpsPort.print(" ");
+        gpsPort.print(c.arg);
+    }
+    gpsPort.println();
+    gps_line_len = 0;
+    gps_cmd_sent = true;
+    gps_cmd_sent_at = millis();
+}
+
+/**
+ * @brief Gives up on the GPS module after a command was never acknowledged.
+ *
+ * The queue is dropped and the serial port released, so the next gps_init() restarts
+ * the module from a reset. The failure callback is told which command failed.
+ */
+static void GPS_Fail(const char *cmd)
+{
+    GPS_Flush();
+    GPS_PortOff();
+    if (gps_failure_cb != nullptr)
+        gps_failure_cb(cmd);
+}
+
+/**
+ * @brief Handles a line received from the GPS module.
+ *
+ * @param line The received line, without line terminator.
+ */
+static void GPS_Line(const char *line)
+{
+    if (gps_cmd_count == 0 || !gps_cmd_sent)
+        return;
+
+    const GpsCommand &c = gps_cmd_queue[gps_cmd_head];
+    if (!GPS_IsAck(line, c.cmd))
+        return;
+
+    void (*done)(void) = c.done;
+    gps_cmd_head = (gps_cmd_head + 1) % GPS_CMD_QUEUE_LEN;
+    gps_cmd_count--;
+    gps_cmd_sent = false;
+    gps_cmd_retries = 0;
+    if (done != nullptr)
+        done();
+}
+
+/**
+ * @brief Handles a span of characters received from the GPS module.
+ *
+ * Feeds the whole span to the NMEA parser, which skips the sentences it does not use.
+ * Lines are only collected while a command waits for its acknowledge.
+ *
+ * @param data The received characters.
+ * @param len Number of characters.
+ */
+static void GPS_Rx(const uint8_t *data, size_t len)
+{
+    gps->encode((const char *)data, len);
+    if (gps_cmd_count == 0)
+        return;
+
+    for (size_t i = 0; i < len && !GPS_SLEEP_FLAG; i++)
+    {
+        char c = data[i];
+        if (c == '\n')
         {
-            gpsPort.print(cmd);
-            gpsPort.print(" ");
-            gpsPort.println(arg);
+            gps_line[gps_line_len] = '\0';
+            gps_line_len = 0;
+            GPS_Line(gps_line);
         }
-        else
+        else if (c != '\r' && gps_line_len < sizeof(gps_line) - 1)
         {
-            gpsPort.println(cmd);
+            gps_line[gps_line_len++] = c;
         }
-        String ack = "";
-        uint32_t smap = millis() + 500;
-        while (millis() < smap)
+    }
+}
+
+/**
+ * @brief Drops the characters received so far, after some were lost.
+ *
+ * The parser and the line collector skip up to the next sentence or line, so no
+ * sentence is parsed from the characters before and after the gap.
+ *
+ * @param lost Number of characters dropped, traced; 0 if unknown.
+ */
+static void GPS_Resync(uint32_t lost)
+{
+    trace(TRACE_GPS_OVERRUN, lost);
+    gps->resync();
+    gps_line_len = 0;
+}
+
+/**
+ * @brief Returns the number of characters written by the DMA since the reception
+ * started.
+ *
+ * Half and full transfer events that are pending but not served yet are counted when
+ * the counter shows they happened, like the overflows of the time base.
+ */
+static uint32_t GPS_DmaWritten(void)
+{
+    const uint16_t half = GPS_DMA_BUF_LEN / 2;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t halves = gps_dma_halves;
+    uint16_t head = GPS_DMA_BUF_LEN - __HAL_DMA_GET_COUNTER(&hdma_gps_rx);
+    if (head == GPS_DMA_BUF_LEN)
+        head = 0;
+    if (__HAL_DMA_GET_FLAG(&hdma_gps_rx, DMA_FLAG_HT6) && head >= half)
+        halves++;
+    if (__HAL_DMA_GET_FLAG(&hdma_gps_rx, DMA_FLAG_TC6) && head < half)
+        halves++;
+    __set_PRIMASK(primask);
+
+    return halves * half + head % half;
+}
+
+/**
+ * @brief Hands the characters received by DMA since the last call to GPS_Rx().
+ *
+ * The ring buffer is passed as at most two contiguous spans. If the DMA wrote more
+ * than a lap since the last call, unread characters were overwritten: the ring is
+ * dropped and the parser resynced instead of being fed old and new characters as one
+ * span. The reception is restarted if a UART error aborted it.
+ */
+static void GPS_DmaRead(void)
+{
+    UART_HandleTypeDef *huart = gpsPort.handle();
+    if (huart->RxState != HAL_UART_STATE_BUSY_RX)
+    {
+        GPS_Resync(0);
+        GPS_DmaReceive();
+        return;
+    }
+
+    uint32_t written = GPS_DmaWritten();
+    uint32_t pending = written - gps_dma_read;
+    if (pending > GPS_DMA_BUF_LEN)
+    {
+        GPS_Resync(pending);
+        gps_dma_read = written;
+        return;
+    }
+
+    while (pending > 0 && !GPS_SLEEP_FLAG)
+    {
+        uint16_t tail = gps_dma_read % GPS_DMA_BUF_LEN;
+        uint16_t len = pending < (uint32_t)(GPS_DMA_BUF_LEN - tail) ? pending : GPS_DMA_BUF_LEN - tail;
+        GPS_Rx(&gps_dma_buf[tail], len);
+        gps_dma_read += len;
+        pending -= len;
+    }
+}
+
+/**
+ * @brief Sends the next queued command, or re-sends the current one on timeout.
+ */
+static void GPS_Poll(void)
+{
+    if (gps_cmd_count == 0)
+        return;
+
+    const GpsCommand &c = gps_cmd_queue[gps_cmd_head];
+    if (gps_cmd_sent)
+    {
+        if (millis() - gps_cmd_sent_at < c.timeout_ms)
+            return;
+        if (gps_cmd_retries++ == GPS_CMD_MAX_RETRIES)
         {
-            if (gpsPort.available() > 0)
-            {
-                ack = gpsPort.readStringUntil('\n');
-                String acc = "[" + cmd.substring(1) + "] " + "Done";
-                if (ack.startsWith(acc))
-                {
-                    return;
-                }
-            }
+            GPS_Fail(c.cmd);
+            return;
         }
     }
+    GPS_Send(c);
+}
+
+/**
+ * @brief Registers the function called when the GPS module stops answering.
+ *
+ * @param cb The function, called with the command that was not acknowledged.
+ */
+void gps_on_failure(GpsFailureCallback cb)
+{
+    gps_failure_cb = cb;
+}
+
+/**
+ * @brief Registers the function called on every new position fix.
+ *
+ * @param cb The function, the fix is read from the gps parser.
+ */
+void gps_on_fix(GpsFixCallback cb)
+{
+    gps_fix_cb = cb;
 }
 
 /**
  * @brief Initializes the GPS module.
  *
- * This function sets up the GPS module by configuring the necessary pins, enabling the
- * GPS module, resetting it, and sending initialization commands to set various
- * parameters. It ensures the GPS module is ready for operation.
+ * This function powers the GPS module, starts its reset pulse and queues the commands
+ * that configure it. It does not block: the reset, boot and configuration progress
+ * from gps_loop(), so the GPS bring-up overlaps with the LoRaWAN join.
  */
 void gps_init(void)
 {
     if (GPS_SLEEP_FLAG){
-        gps = new TinyGPSPlus();
+        gps_parser.reset();
+        gps = &gps_parser;
+        gps_fix_count = 0;
         gpsPort.begin(GPS_BAUD_RATE);
         pinMode(GPS_EN, OUTPUT);
         digitalWrite(GPS_EN, HIGH);
+        meter_set(METER_GPS_ON);
         pinMode(GPS_RST, GPIO_PULLUP);
-        // Set  Reset Pin as 0
+        // Set  Reset Pin as 0, gps_loop() releases it
         digitalWrite(GPS_RST, LOW);
-        // Scope shows 1.12s (Low Period)
-        delay(200);
-        // Set  Reset Pin as 1
-        digitalWrite(GPS_RST, HIGH);
-        delay(500);
-
-        GPS_WaitAck("@GSTP"); //Positioning stop
-        GPS_WaitAck("@BSSL", "0x2EF"); //Output sentence select, all outputs
-        GPS_WaitAck("@GSOP", "1 1000 0"); //Operation mode normal, position cycle, sleep time
-        GPS_WaitAck("@GNS", "0x03"); // Use the GPS and GLONASS systems.
-        //! Start GPS connamd
-        GPS_WaitAck("@GSR");
-        delay(200);
+        gps_state = GPS_STATE_RESET;
+        gps_state_since = millis();
+
+        GPS_Flush();
+        GPS_QueueStart();
         GPS_SLEEP_FLAG = false;
     }
+    else if (gps_sleep_pending)
+    {
+        // Still awake, cancel the sleep sequence and restart positioning
+        GPS_Flush();
+        GPS_QueueStart();
+    }
 }
 
 /**
  * @brief Puts the GPS module into sleep mode to save power.
  *
- * This function stops the GPS positioning, puts the GPS module into sleep mode, and
- * ends the serial communication to save power. It also updates the GPS sleep flag.
+ * This function queues the positioning stop and sleep commands. Once the module
+ * acknowledges them, the serial port is released and the GPS sleep flag is set. Any
+ * wake up planned by gps_plan_fix() is cancelled.
  */
 void gps_sleep(void) {
-    if (!GPS_SLEEP_FLAG){
-        gpsPort.flush();
-        GPS_WaitAck("@GSTP"); //Positioning stop
-        GPS_WaitAck("@SLP", "2");//Sleep mode 2
-        Serial.println(F("GPS SLEEP!!"));
-        gpsPort.end();
-        GPS_SLEEP_FLAG = true;
+    os_clearCallback(&gps_wake_job);
+    gps_ttff_pending = false;
+    if (!GPS_SLEEP_FLAG && !gps_sleep_pending){
+        GPS_Flush();
+        GPS_Queue("@GSTP"); //Positioning stop
+        GPS_Queue("@SLP", "2", GPS_SleepDone); //Sleep mode 2
+        gps_sleep_pending = true;
+    }
+}
+
+/**
+ * @brief Records that the GPS module reported a fix.
+ *
+ * When the module was woken up by the duty cycling, the time to first fix is added to
+ * the history used to pick the lead time.
+ */
+static void GPS_FixSeen(void)
+{
+    gps_fix_fresh = true;
+    if (gps_fix_cb != nullptr)
+        gps_fix_cb();
+    if (!gps_ttff_pending)
+        return;
+
+    gps_ttff_pending = false;
+    gps_ttff_ms[gps_ttff_pos] = osticks2ms(os_getTime() - gps_woken_at);
+    gps_ttff_pos = (gps_ttff_pos + 1) % GPS_TTFF_HISTORY;
+    if (gps_ttff_count < GPS_TTFF_HISTORY)
+        gps_ttff_count++;
+}
+
+/**
+ * @brief Computes how long before an uplink the GPS module has to be woken up.
+ *
+ * @return The worst recent time to first fix plus a margin, in milliseconds.
+ */
+static uint32_t GPS_Lead(void)
+{
+    if (gps_ttff_count == 0)
+        return GPS_LEAD_DEFAULT_MS;
+
+    uint32_t worst = 0;
+    for (uint8_t i = 0; i < gps_ttff_count; i++)
+        worst = max(worst, gps_ttff_ms[i]);
+    return constrain(worst + GPS_LEAD_MARGIN_MS, GPS_LEAD_MIN_MS, GPS_LEAD_MAX_MS);
+}
+
+/**
+ * @brief Wakes the GPS module up ahead of an uplink, from the LMIC scheduler.
+ */
+static void GPS_WakeJob(osjob_t *j)
+{
+    (void)j;
+    gps_init();
+    gps_woken_at = os_getTime();
+    gps_ttff_pending = true;
+}
+
+/**
+ * @brief Duty cycles the GPS module around the next uplink.
+ *
+ * Called once the next uplink is scheduled. If the module already reported a fix for
+ * this uplink period and the next uplink is far enough, it is put to sleep and woken
+ * up again just long enough before the uplink to get a hot start fix. The lead time
+ * tracks the recent times to first fix. A module still looking for a fix is left on.
+ *
+ * @param send_in_ms Time until the next uplink in milliseconds.
+ */
+void gps_plan_fix(uint32_t send_in_ms)
+{
+    ostime_t now = os_getTime();
+    uint32_t lead_ms = GPS_Lead();
+    bool fresh = gps_fix_fresh;
+    gps_fix_fresh = false;
+
+    if (send_in_ms <= lead_ms + GPS_SLEEP_MIN_MS)
+    {
+        if (GPS_SLEEP_FLAG || gps_sleep_pending)
+            GPS_WakeJob(&gps_wake_job);
+        return;
+    }
+
+    if (!GPS_SLEEP_FLAG && !gps_sleep_pending)
+    {
+        if (!fresh)
+            return;
+        gps_sleep();
     }
+    os_setTimedCallback(&gps_wake_job, now + ms2osticks(send_in_ms - lead_ms), GPS_WakeJob);
+}
+
+/**
+ * @brief Adapts the GPS output to what the firmware consumes.
+ *
+ * Only the sentences used by the firmware are enabled, and the position cycle is derived
+ * from the uplink interval: a few fixes per uplink, or one per second in fast mode. The
+ * receiver is reconfigured only when the profile changes; if it is asleep, the profile
+ * is applied by the next gps_init().
+ *
+ * @param tx_interval_s Current uplink interval in seconds.
+ * @param fast true if TX fast mode is enabled.
+ */
+void gps_profile_update(unsigned tx_interval_s, bool fast)
+{
+    uint32_t cycle_ms = GPS_CYCLE_MIN_MS;
+    if (!fast)
+    {
+        cycle_ms = tx_interval_s * 1000 / GPS_FIXES_PER_TX;
+        cycle_ms -= cycle_ms % 1000;
+        cycle_ms = constrain(cycle_ms, GPS_CYCLE_MIN_MS, GPS_CYCLE_MAX_MS);
+    }
+
+    if (cycle_ms == gps_profile_cycle_ms)
+        return;
+    gps_profile_cycle_ms = cycle_ms;
+
+    if (!GPS_SLEEP_FLAG && !gps_sleep_pending)
+    {
+        GPS_Flush();
+        GPS_QueueStart();
+    }
+}
+
+/**
+ * @brief Tells whether the GPS module is powered and streaming.
+ *
+ * @return true if the GPS is running, false if it is in sleep mode.
+ */
+bool gps_awake(void)
+{
+    return !GPS_SLEEP_FLAG;
+}
+
+/**
+ * @brief Tells whether the GPS module is resetting or has commands in flight.
+ *
+ * Command timeouts rely on millis(), so the MCU must not be idled while this is true.
+ *
+ * @return true if gps_loop() has work to do besides parsing NMEA sentences.
+ */
+bool gps_busy(void)
+{
+    return !GPS_SLEEP_FLAG && (gps_state != GPS_STATE_READY || gps_cmd_count > 0);
 }
 
 /**
  * @brief Processes GPS data in the main loop.
  *
- * This function reads available data from the GPS module and feeds it to the TinyGPSPlus
- * library for parsing. It ensures that the GPS data is continuously updated when the GPS
- * module is not in sleep mode.
+ * This function advances the reset sequence, feeds the data received by DMA to the
+ * TinyGPSPlus library for parsing, matches command acknowledges and handles command
+ * timeouts. It never blocks.
  */
 void gps_loop(void)
 {
-    if (!GPS_SLEEP_FLAG)
+    if (GPS_SLEEP_FLAG)
+        return;
+
+    switch (gps_state)
     {
-        while (gpsPort.available() > 0)
+    case GPS_STATE_RESET:
+        if (millis() - gps_state_since >= GPS_RESET_MS)
         {
-            gps->encode(gpsPort.read());
+            // Set  Reset Pin as 1
+            digitalWrite(GPS_RST, HIGH);
+            gps_state = GPS_STATE_BOOT;
+            gps_state_since = millis();
         }
+        return;
+    case GPS_STATE_BOOT:
+        if (millis() - gps_state_since < GPS_BOOT_MS)
+            return;
+        GPS_DmaStart();
+        gps_state = GPS_STATE_READY;
+        break;
+    default:
+        break;
+    }
+
+    GPS_DmaRead();
+    if (GPS_SLEEP_FLAG)
+        return;
+
+    if (gps->sentencesWithFix() != gps_fix_count)
+    {
+        gps_fix_count = gps->sentencesWithFix();
+        GPS_FixSeen();
     }
-}
\ No newline at end of file
+    GPS_Poll();
+}
@@ -3,9 +3,18 @@
 
 #include <TinyGPS++.h>
 
+typedef void (*GpsFailureCallback)(const char *cmd);
+typedef void (*GpsFixCallback)(void);
+
 void gps_init(void);
 void gps_loop(void);
 void gps_sleep(void);
+bool gps_awake(void);
+bool gps_busy(void);
+void gps_on_failure(GpsFailureCallback cb);
+void gps_on_fix(GpsFixCallback cb);
+void gps_profile_update(unsigned tx_interval_s, bool fast);
+void gps_plan_fix(uint32_t send_in_ms);
 extern TinyGPSPlus *gps;
 
-#endif /* __GPS_H__ */
\ No newline at end of file
+#endif /* __GPS_H__ */
@@ -3,15 +3,34 @@
 #include <hal/hal.h>
 #include "config.h"
 #include <CayenneLPP.h>
-#include "STM32LowPower.h"
 
 #include "oled.h"
 #include "gps.h"
 #include "Bat.h"
+#include "energy_mgmt.h"
+#include "timebase.h"
+#include "touch.h"
+#include "payload.h"
+#include "session.h"
+#include "airtime.h"
+#include "adr.h"
+#include "fixlog.h"
+#include "meter.h"
+#include "trace.h"
+#include "ui.h"
+#include "motion.h"
+#include "loramac.h"
 
 #include "../.secrets/secrets.h"
 
-CayenneLPP lpp(200);
+#ifdef PAYLOAD_COMPACT
+static uint8_t payload_buf[PAYLOAD_BATCH_MAX_SIZE];
+static uint8_t payload_size = 0;
+static bool payload_confirmed = false;
+#else
+static uint8_t lpp_buffer[200];
+CayenneLPP lpp(lpp_buffer, sizeof(lpp_buffer));
+#endif
 
 // Chose LSB mode on the console and then copy it here.
 static const u1_t PROGMEM APPEUI[8] = APPEUI_SECRET;
@@ -20,12 +39,75 @@ static const u1_t PROGMEM DEVEUI[8] = DEVEUI_SECRET;
 // MSB mode
 static const u1_t PROGMEM APPKEY[16] = APPKEY_SECRET;
 
+/**
+ * @brief LMIC HAL hooks for the T-Impulse board.
+ *
+ * Implements tickless idle: when the LMIC has nothing runnable, the MCU is idled until
+ * the next scheduled job (or an interrupt) instead of spinning in os_runloop_once().
+ * The LMIC time base is LPTIM1, which keeps counting while the MCU is stopped.
+ */
+class TImpulseHalConfig : public Arduino_LMIC::HalConfiguration_t
+{
+public:
+    virtual void begin(void) override
+    {
+        timebase_init();
+    }
+
+    virtual bool getTicks(uint32_t &ticks) override
+    {
+        ticks = timebase_ticks();
+        return true;
+    }
+
+    virtual ostime_t sleep(bool fTimed, ostime_t ticks) override
+    {
+        // Gesture, GPS command and splash timing rely on millis(), stay awake until they complete
+        if (!touch_idle() || gps_busy() || oled_busy())
+            return 0;
+
+        uint32_t ms = fTimed ? osticks2ms(ticks) : 0;
+        if (fTimed && ms == 0)
+            return 0;
+
+        // No ticks are lost, the time base keeps running while idle
+        Board_Idle(ms);
+        return 0;
+    }
+
+    virtual void radioMode(uint8_t mode) override
+    {
+        // LMIC.rps holds the parameters of the frame being sent or received
+        switch (mode)
+        {
+        case HAL_RADIO_TX:
+            meter_set((MeterState)(METER_RADIO_TX_FSK + getSf(LMIC.rps)));
+            break;
+        case HAL_RADIO_RX:
+            meter_set((MeterState)(METER_RADIO_RX_FSK + getSf(LMIC.rps)));
+            break;
+        case HAL_RADIO_STANDBY:
+            meter_set(METER_RADIO_STANDBY);
+            break;
+        default:
+            meter_set(METER_RADIO_SLEEP);
+            break;
+        }
+    }
+};
+
+static TImpulseHalConfig halConfig;
+
 // Pin mapping
 const lmic_pinmap lmic_pins = {
     .nss = LORA_NSS,
     .rxtx = RADIO_ANT_SWITCH_RXTX,
     .rst = LORA_RST,
     .dio = {LORA_DIO0, LORA_DIO1_PIN, LORA_DIO2_PIN},
+    .rxtx_rx_active = 0,
+    .rssi_cal = 0,
+    .spi_freq = 0,
+    .pConfig = &halConfig,
 };
 
 static osjob_t sendjob;
@@ -37,6 +119,12 @@ static const unsigned TX_RETRY_INTERVAL = 15;
 static const unsigned JOIN_RETRY_INTERVAL = 15;
 static bool tx_fast_flag = false;
 static bool dev_interior = false;
+static uint8_t tx_payload_len = 0;
+static uint16_t tx_fix_count = 0;
+// Bytes left free in each uplink for the MAC commands piggybacked by LMIC
+static const uint8_t TX_FOPTS_RESERVE = 8;
+// The backlog of fixes goes on the LPP channels after this one, the latest is on 3
+static const uint8_t LPP_BATCH_CHANNEL = 10;
 static const int TX_CHANNEL_QTY = 4;
 static int latest_tx_channels[4] = {-1, -1, -1, -1};
 static int tx_channel_pos = 0;
@@ -54,6 +142,7 @@ void setupLMIC(void);
 void setTXFast(bool mode)
 {
     tx_fast_flag = mode;
+    gps_profile_update(getTXInterval(), tx_fast_flag);
 }
 
 /**
@@ -68,6 +157,19 @@ bool getTXFast()
     return tx_fast_flag;
 }
 
+/**
+ * @brief Retrieves the interval between uplinks.
+ *
+ * @return The uplink interval in seconds for the current transmission mode, or the
+ * heartbeat interval while the device is stationary.
+ */
+unsigned getTXInterval(void)
+{
+    if (!motion_moving())
+        return MOTION_HEARTBEAT_S;
+    return tx_fast_flag ? TX_INTERVAL_FAST : TX_INTERVAL;
+}
+
 /**
  * @brief Retrieves the device interior status.
  *
@@ -80,52 +182,110 @@ bool getDEV_INTERIOR()
     return dev_interior;
 }
 
+/**
+ * @brief Returns the largest payload that can be sent at the current data rate.
+ *
+ * The limit is the frame size LMIC_feasibleDataRateForFrame() checks, so LMIC does not
+ * raise the data rate, minus the LoRaWAN overhead and room for MAC commands.
+ *
+ * @return The payload size in bytes.
+ */
+static uint8_t txMaxPayload(void)
+{
+    // MHDR, FHDR without options, FPort and MIC
+    int len = LMICbandplan_maxFrameLen(LMIC.datarate) - 13 - TX_FOPTS_RESERVE;
+    return len < 0 ? 0 : len;
+}
+
 /**
  * @brief Collects and prints various sensor data.
  *
- * This function gathers data from GPS, interior status, recent transmission channels,
- * and battery level, then formats and adds it to a CayenneLPP payload for transmission.
+ * This function gathers the pending GPS fixes of the fix log, interior status, recent
+ * transmission channels, and battery level, then formats and adds them to a CayenneLPP
+ * payload for transmission. When built with PAYLOAD_COMPACT, the compact bit-packed
+ * payload is used instead. As many pending fixes as fit at the current data rate are
+ * batched in one uplink, the oldest first, along with the latest one.
  */
 void printVariables()
 {
-    lpp.reset();
-
-    if (gps != nullptr && gps->location.isUpdated() && gps->altitude.isUpdated() && gps->satellites.isUpdated())
-    {
-        double gps_lat = gps->location.lat();
-        double gps_lng = gps->location.lng();
-        double gps_alt = gps->altitude.meters();
-        lpp.addGPS(3, (float)gps_lat, (float)gps_lng, (float)gps_alt);
-    }
-
-    if (dev_interior)
-        lpp.addDigitalInput(4, 1); // Interior
-    else
-        lpp.addDigitalInput(4, 0); // Exterior
+    uint8_t max_len = txMaxPayload();
+    uint16_t pending = fixlog_count();
+    FixRecord fix;
 
     // Write channels used in the last 4 tx
     // Bits position represent the channel, B0->Ch0... 1s means channel used
-    Serial.printf("Channel next TX: %d\n", LMIC.txChnl);
     latest_tx_channels[tx_channel_pos] = LMIC.txChnl; // Save tx ch
     tx_channel_pos = (tx_channel_pos + 1) % TX_CHANNEL_QTY;
     int tx_channels_used = 0;
-    Serial.printf("latest_tx_channels = ");
     for (int i = 0; i < TX_CHANNEL_QTY; i++)
     {
-        Serial.printf("%d,", latest_tx_channels[i]);
         // At begining array is filled with -1. If to ignore them.
         if (latest_tx_channels[i] > -1)
         {
             tx_channels_used |= 1 << latest_tx_channels[i];
         }
     }
-    Serial.printf("\n");
-    lpp.addDigitalInput(5, tx_channels_used);
-    Serial.printf("tx_channels_used: %d\n", tx_channels_used);
+    trace(TRACE_TX_CHANNELS, LMIC.txChnl, tx_channels_used);
 
-    float batt_lvl = float((Volt * 3.3 * 2) / 4096);
-    Serial.printf("BatteryVol : %f\n", batt_lvl);
+    float batt_lvl = bat_mv() / 1000.0f;
+    trace(TRACE_BATTERY, bat_mv(), bat_soc());
+
+    trace(TRACE_PENDING, pending, max_len);
+    trace(TRACE_ENERGY, meter_uah(METER_MCU), meter_uah(METER_GPS), meter_uah(METER_OLED));
+    trace(TRACE_ENERGY_RADIO, meter_uah(METER_RADIO), meter_uah(METER_ADC), meter_total_uah());
+
+#ifdef PAYLOAD_COMPACT
+    if (pending > 1)
+    {
+        if (max_len > sizeof(payload_buf))
+            max_len = sizeof(payload_buf);
+        payload_size = payload_encode_batch(payload_buf, max_len, dev_interior, tx_channels_used,
+                                            batt_lvl, &tx_fix_count);
+        payload_confirmed = false;
+    }
+    else
+    {
+        bool gps_fix = fixlog_get(0, &fix);
+        payload_size = payload_encode(payload_buf, gps_fix, fix.lat / 1e6, fix.lng / 1e6, fix.alt,
+                                      dev_interior, tx_channels_used, batt_lvl, &payload_confirmed);
+        tx_fix_count = gps_fix ? 1 : 0;
+    }
+#else
+    if (max_len > sizeof(lpp_buffer))
+        max_len = sizeof(lpp_buffer);
+    lpp.reset();
+    if (dev_interior)
+        lpp.addDigitalInput(4, 1); // Interior
+    else
+        lpp.addDigitalInput(4, 0); // Exterior
+    lpp.addDigitalInput(5, tx_channels_used);
     lpp.addAnalogInput(8, batt_lvl);
+#ifdef METER_UPLINK
+    lpp.addGenericSensor(9, meter_total_uah()); // Charge drawn since power up, uAh
+#endif
+    // The latest fix goes on channel 3, the older pending ones on the batch channels,
+    // oldest first. With a backlog, each fix has its age in seconds. The latest fix
+    // leaves the log with the last of the backlog, until then it is sent again.
+    uint32_t now = fixlog_now();
+    tx_fix_count = 0;
+    if (pending && fixlog_get(pending - 1, &fix))
+    {
+        lpp.addGPS(3, fix.lat / 1e6f, fix.lng / 1e6f, (float)fix.alt);
+        if (pending > 1)
+            lpp.addGenericSensor(3, fixlog_age(&fix, now));
+        while (tx_fix_count < pending - 1 && fixlog_get(tx_fix_count, &fix))
+        {
+            if (lpp.getSize() + LPP_GPS_SIZE + LPP_GENERIC_SENSOR_SIZE + 4 > max_len)
+                break;
+            uint8_t channel = LPP_BATCH_CHANNEL + 1 + tx_fix_count;
+            lpp.addGPS(channel, fix.lat / 1e6f, fix.lng / 1e6f, (float)fix.alt);
+            lpp.addGenericSensor(channel, fixlog_age(&fix, now));
+            tx_fix_count++;
+        }
+        if (tx_fix_count == pending - 1)
+            tx_fix_count = pending;
+    }
+#endif
 }
 
 void os_getArtEui(u1_t *buf)
@@ -147,8 +307,8 @@ void os_getDevKey(u1_t *buf)
  * @brief Sends data over LoRaWAN.
  *
  * This function checks the join status and current operation mode, prepares the data
- * for transmission, and schedules the next transmission. It also updates the display
- * with the current transmission status and battery level.
+ * for transmission, and schedules the next transmission. It also updates the status
+ * screen fields: TX state, battery level and satellites.
  *
  * @param j Pointer to the job structure.
  */
@@ -156,204 +316,225 @@ void do_send(osjob_t *j)
 {
     if (joinStatus == EV_JOINING)
     {
-        Serial.println(F("Not joined yet"));
+        trace(TRACE_NOT_JOINED);
         // Check if there is not a current TX/RX job running
         os_setTimedCallback(&sendjob, os_getTime() + sec2osticks(TX_RETRY_INTERVAL), do_send);
     }
     else if (LMIC.opmode & OP_TXRXPEND)
     {
-        Serial.println(F("OP_TXRXPEND, not sending"));
+        trace(TRACE_TX_BUSY);
     }
     else
     {
         // Sending process
-        Serial.println(F("OP_TXRXPEND,sending ..."));
-        u8g2->sleepOff();
-
         printVariables();
-        LMIC_setTxData2(1, lpp.getBuffer(), lpp.getSize(), 0);
+#ifdef PAYLOAD_COMPACT
+        tx_payload_len = payload_size;
+        trace(TRACE_SENDING, tx_payload_len, PAYLOAD_COMPACT_PORT);
+        LMIC_setTxData2(PAYLOAD_COMPACT_PORT, payload_buf, payload_size, payload_confirmed);
+#else
+        tx_payload_len = lpp.getSize();
+        trace(TRACE_SENDING, tx_payload_len, PAYLOAD_LPP_PORT);
+        LMIC_setTxData2(PAYLOAD_LPP_PORT, lpp.getBuffer(), lpp.getSize(), 0);
+#endif
 
         // Schedule again the send process, this task is supposed to be override by a task schedule at the end of the TX event
         os_setTimedCallback(&sendjob, os_getTime() + sec2osticks(TX_RETRY_INTERVAL), do_send);
 
-        if (u8g2)
-        {
-            // Draw OLED screen
-            char buf[256];
-            u8g2->clearBuffer();
-            float batt_lvl = float((Volt * 3.3 * 2) / 4096);
-            snprintf(buf, sizeof(buf), "Batt: %.2f", batt_lvl);
-            u8g2->drawStr(0, 7, buf);
-            if (gps != nullptr)
-            {
-                if (!dev_interior)
-                {
-                    snprintf(buf, sizeof(buf), "#GPS: %d", gps->satellites.value());
-                }
-                else
-                {
-                    snprintf(buf, sizeof(buf), "#GPS: Sleep");
-                }
-            }
-            else
-            {
-                snprintf(buf, sizeof(buf), "#GPS: N/A");
-            }
-            u8g2->drawStr(0, 17, buf);
-            snprintf(buf, sizeof(buf), "Sending");
-            u8g2->drawStr(0, 27, buf);
-            u8g2->sendBuffer();
-        }
+        ui_set_battery(bat_mv());
+        if (gps == nullptr)
+            ui_set_gps(UI_GPS_NONE);
+        else if (dev_interior || !motion_moving())
+            ui_set_gps(UI_GPS_SLEEP);
+        else
+            ui_set_gps(gps->satellites.value());
+        ui_set_tx(UI_TX_SENDING);
     }
 }
 
+/**
+ * @brief Sends an uplink as soon as possible.
+ *
+ * This function replaces the scheduled transmission with an immediate one. do_send()
+ * takes care of the join status and of any pending TX/RX.
+ */
+void sendNow(void)
+{
+    os_setCallback(&sendjob, do_send);
+}
+
 /**
  * @brief Handles events from the LoRaWAN stack.
  *
  * This function processes various events such as join complete, transmission complete,
- * and data received, and takes appropriate actions like updating the display, scheduling
- * the next transmission, and putting the device into sleep mode.
+ * and data received, and takes appropriate actions like updating the status screen,
+ * scheduling the next transmission, and putting the device into sleep mode. It never
+ * blocks, the display is drawn later from ui_loop().
  *
  * @param ev The event type.
  */
 void onEvent(ev_t ev)
 {
-    uint32_t sleep_ms = (tx_fast_flag ? TX_INTERVAL_FAST : TX_INTERVAL) * 1000;
     switch (ev)
     {
     case EV_TXCOMPLETE:
-        Serial.println(F("EV_TXCOMPLETE (includes waiting for RX windows)"));
-        if (u8g2)
-        {
-            char buf[256];
-            u8g2->setDrawColor(2);
-            snprintf(buf, sizeof(buf), "Sending");
-            u8g2->drawStr(0, 27, buf);
-            u8g2->setDrawColor(1);
-            snprintf(buf, sizeof(buf), "Sended");
-            u8g2->drawStr(0, 27, buf);
-            u8g2->sendBuffer();
-            delay(200);
-            u8g2->sleepOn();
-        }
+        trace(TRACE_EV_TXCOMPLETE, LMIC.txrxFlags);
+        ui_set_tx(UI_TX_SENT);
+        // Fixes are kept for the next uplink if this one was not sent or not acknowledged
+        if (!(LMIC.txrxFlags & (TXRX_LENERR | TXRX_NACK)))
+            fixlog_consume(tx_fix_count);
+        tx_fix_count = 0;
         if (LMIC.txrxFlags & TXRX_ACK)
         {
-            Serial.println(F("Received ack"));
+            trace(TRACE_ACK);
+#ifdef PAYLOAD_COMPACT
+            payload_ack();
+#endif
         }
 
         if (LMIC.dataLen)
         {
-            // data received in rx slot after tx
-            // Serial.print(F("Data Received: "));
-            int port = LMIC.dataBeg - 1;
-            Serial.printf("Puerto: %d\n", port);
-            Serial.write(LMIC.frame + LMIC.dataBeg, LMIC.dataLen);
-            Serial.println();
-            Serial.print(LMIC.dataLen);
-            Serial.println(F(" bytes of payload"));
+            // data received in rx slot after tx, the port precedes the payload
+            int port = LMIC.frame[LMIC.dataBeg - 1];
+            trace(TRACE_DOWNLINK, port, LMIC.dataLen, LMIC.frame[LMIC.dataBeg]);
             if (*(LMIC.frame + LMIC.dataBeg) == 'I')
             {
-                Serial.println("Interior");
+                trace(TRACE_INTERIOR);
                 dev_interior = true;
                 gps_sleep();
             }
             else if (*(LMIC.frame + LMIC.dataBeg) == 'E')
             {
-                Serial.println("Exterior");
+                trace(TRACE_EXTERIOR);
                 dev_interior = false;
-                gps_init();
+                if (motion_moving())
+                    gps_init();
             }
             else
             {
-                Serial.println("RX_PAYLOAD_ERR");
+                trace(TRACE_RX_PAYLOAD_ERR);
             }
         }
-        // Schedule next transmission
-        os_setTimedCallback(&sendjob, os_getTime() + sec2osticks(1), do_send);
-        LowPower.deepSleep(sleep_ms);
+        adr_update();
+        // Reserve the next block of frame counters in EEPROM, or save the downlink counter,
+        // when needed
+        session_update();
+        // Schedule next transmission within the duty cycle and airtime budget, the MCU
+        // idles until then (see hal_sleep())
+        {
+            unsigned interval = airtime_next_interval(getTXInterval(), tx_payload_len);
+            trace(TRACE_NEXT_TX, airtime_budget_left(), interval);
+            os_setTimedCallback(&sendjob, os_getTime() + sec2osticks(interval), do_send);
+            if (!dev_interior && motion_moving())
+                gps_plan_fix(interval * 1000);
+        }
         break;
     case EV_JOINING:
-        Serial.println(F("EV_JOINING: -> Joining..."));
+        trace(TRACE_EV_JOINING);
         joinStatus = EV_JOINING;
-
-        if (u8g2)
-        {
-            u8g2->clearBuffer();
-            u8g2->setFont(u8g2_font_IPAandRUSLCD_tr);
-            u8g2->drawStr(0, 20, "JOINING");
-            u8g2->sendBuffer();
-        }
-
+        ui_set_link(UI_LINK_JOINING);
         break;
     case EV_JOIN_FAILED:
-        Serial.println(F("EV_JOIN_FAILED: -> Joining failed"));
-
-        if (u8g2)
-        {
-            u8g2->clearBuffer();
-            u8g2->drawStr(0, 12, "OTAA joining failed");
-            u8g2->sendBuffer();
-        }
-
+        trace(TRACE_EV_JOIN_FAILED);
+        ui_set_link(UI_LINK_JOIN_FAILED);
         break;
     case EV_JOINED:
-        Serial.println(F("EV_JOINED"));
+        trace(TRACE_EV_JOINED);
         joinStatus = EV_JOINED;
+#ifdef PAYLOAD_COMPACT
+        payload_reset();
+#endif
+        session_save();
+        ui_set_link(UI_LINK_JOINED);
 
-        if (u8g2)
-        {
-            u8g2->clearBuffer();
-            u8g2->drawStr(0, 12, "Joined TTN!");
-            u8g2->sendBuffer();
-        }
-
-        delay(3);
-        // Disable link check validation (automatically enabled
-        // during join, but not supported by TTN at this time).
-        LMIC_setLinkCheckMode(0);
+        // ADR with the device side fallback policy
+        adr_init();
 
         do_send(&sendjob);
         break;
     case EV_RXCOMPLETE:
-        Serial.println(F("EV_RXCOMPLETE"));
+        trace(TRACE_EV_RXCOMPLETE);
         break;
     case EV_LINK_DEAD:
-        Serial.println(F("EV_LINK_DEAD"));
+        trace(TRACE_EV_LINK_DEAD);
+        // The network may have lost the session, join again on next boot
+        session_erase();
         break;
     case EV_LINK_ALIVE:
-        Serial.println(F("EV_LINK_ALIVE"));
+        trace(TRACE_EV_LINK_ALIVE);
         break;
     case EV_TXSTART:
-        Serial.println(F("EV_TXSTART"));
+        trace(TRACE_EV_TXSTART, LMIC.txChnl, LMIC.datarate);
+        Board_BootDone();
+        airtime_record();
         break;
     case EV_JOIN_TXCOMPLETE:
-        Serial.println(F("EV_JOIN_TXCOMPLETE"));
-        Serial.println(F("Restarting JOIN process"));
-        setupLMIC();
+        // No join accept, the LMIC retries with its own data rate and backoff schedule
+        trace(TRACE_EV_JOIN_TXCOMPLETE);
         break;
     default:
-        Serial.printf("Unknown event (%d)\n", ev);
+        trace(TRACE_EV_UNKNOWN, ev);
         break;
     }
 }
 
+/**
+ * @brief Adapts the GPS and the uplink interval to the motion state.
+ *
+ * When the device stops moving the GPS is put to sleep, the uplink already scheduled is
+ * sent and the next ones follow at the heartbeat interval. When it moves again the GPS
+ * is woken up, unless the device is in an interior, and the next uplink is brought back
+ * to the normal interval.
+ *
+ * @param moving true if the device started moving.
+ */
+void onMotion(bool moving)
+{
+    gps_profile_update(getTXInterval(), tx_fast_flag);
+    if (!moving)
+    {
+        trace(TRACE_STATIONARY);
+        gps_sleep();
+        return;
+    }
+
+    trace(TRACE_MOVING);
+    if (!dev_interior)
+        gps_init();
+    if (joinStatus == EV_JOINED && !(LMIC.opmode & OP_TXRXPEND))
+    {
+        unsigned interval = airtime_next_interval(getTXInterval(), tx_payload_len);
+        trace(TRACE_NEXT_TX, airtime_budget_left(), interval);
+        os_setTimedCallback(&sendjob, os_getTime() + sec2osticks(interval), do_send);
+    }
+}
+
 /**
  * @brief Configures the SPI and pins for the LoRaWAN module.
  *
  * This function sets the pins for MISO, MOSI, and SCLK for the SPI interface
  * and initializes the SPI communication. It also configures the pin modes and
- * initial states for the radio antenna switch and GPS enable pin.
+ * initial states for the radio antenna switch and GPS enable pin. A session saved
+ * in EEPROM is restored, otherwise an OTAA join is started. The LMIC scheduler is
+ * started by BoardInit().
  */
 void setupLMIC(void)
 {
-    // LMIC init
-    os_init();
-
     // Reset the MAC state. Session and pending data transfers will be discarded.
     LMIC_reset();
 
     LMIC_setClockError(MAX_CLOCK_ERROR * 1 / 100);
 
+    // Restore the session, its channel plan and data rate included
+    if (session_restore())
+    {
+        adr_init();
+        joinStatus = EV_JOINED;
+        ui_set_link(UI_LINK_JOINED);
+        os_setCallback(&sendjob, do_send);
+        return;
+    }
+
     LMIC_setupChannel(0, 868100000, DR_RANGE_MAP(DR_SF12, DR_SF7), BAND_CENTI);  // g-band
     LMIC_setupChannel(1, 868300000, DR_RANGE_MAP(DR_SF12, DR_SF7B), BAND_CENTI); // g-band
     LMIC_setupChannel(2, 868500000, DR_RANGE_MAP(DR_SF12, DR_SF7), BAND_CENTI);  // g-band
@@ -2,6 +2,9 @@
 
 void setupLMIC(void);
 void loopLMIC(void);
+void sendNow(void);
 void setTXFast(bool mode);
 bool getTXFast();
-bool getDEV_INTERIOR();
\ No newline at end of file
+unsigned getTXInterval(void);
+bool getDEV_INTERIOR();
+void onMotion(bool moving);
\ No newline at end of file
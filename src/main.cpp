@@ -1,5 +1,6 @@
 #include <Wire.h>
 #include <SPI.h>
+#include <malloc.h>
 #include "loramac.h"
 #include "config.h"
 #include "oled.h"
@@ -7,64 +8,75 @@
 #include "Bat.h"
 #include "energy_mgmt.h"
 #include "touch.h"
+#include "fixlog.h"
+#include "trace.h"
+#include "ui.h"
+#include "motion.h"
 
 /**
  * @brief Initializes the board and LoRaWAN setup.
  *
- * This function initializes the board peripherals, waits for a short delay, prints a
- * message to the serial monitor, and sets up the LMIC (LoRaWAN) stack.
+ * This function initializes the board peripherals, prints a message to the serial
+ * monitor, restores the fix log and sets up the LMIC (LoRaWAN) stack, which starts the
+ * join without waiting for the splash screen or the GPS configuration. The heap in use
+ * after boot is reported, it must stay at zero as all long-lived objects are static.
  */
 void setup()
 {
     BoardInit();
-    delay(500);
     Serial.println("LoRaWan Demo");
+    fixlog_init();
     setupLMIC();
+    // mallinfo() is deprecated in glibc 2.33, the native build uses mallinfo2()
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    Serial.printf("Heap in use after boot: %u bytes\n", (unsigned)mallinfo2().uordblks);
+#else
+    Serial.printf("Heap in use after boot: %u bytes\n", (unsigned)mallinfo().uordblks);
+#endif
 }
 
 /**
  * @brief Main loop function.
  *
- * This function handles touch input to enter sleep mode or toggle fast transmission mode
- * based on the duration of the touch press. It also calls the main loops for LMIC, battery,
- * and GPS handling.
+ * This function handles touch gestures: a long press enters sleep mode, a click toggles
+ * fast transmission mode and a double click sends an uplink right away. It also calls the
+ * main loops for LMIC, battery, GPS, display and status screen handling, then
+ * sends the trace records. None of them blocks.
  */
 void loop()
 {
-    int touch_press_time = TouchCallback();
-    if (touch_press_time > 3000) // Long press for 3 seconds to enter sleep mode
+    switch (touch_loop())
     {
+    case TOUCH_LONG_PRESS: // Long press for 3 seconds to enter sleep mode
         Board_Sleep();
-    }
-    else if (touch_press_time > 200)
+        break;
+    case TOUCH_DOUBLE_CLICK:
+        sendNow();
+        break;
+    case TOUCH_CLICK:
     {
         //Toggle TX fast mode
         bool tx_fast_flag = getTXFast();
         if (tx_fast_flag)
         {
             setTXFast(false);
-            if (u8g2)
-            {
-                u8g2->clearBuffer();
-                u8g2->setFont(u8g2_font_IPAandRUSLCD_tr);
-                u8g2->drawStr(0, 12, "TX Fast OFF");
-                u8g2->sendBuffer();
-            }
+            ui_notify("TX Fast OFF");
         }
         else
         {
             setTXFast(true);
-            if (u8g2)
-            {
-                u8g2->clearBuffer();
-                u8g2->setFont(u8g2_font_IPAandRUSLCD_tr);
-                u8g2->drawStr(0, 12, "TX Fast ON");
-                u8g2->sendBuffer();
-            }
+            ui_notify("TX Fast ON");
         }
+        break;
+    }
+    default:
+        break;
     }
 
     loopLMIC();
     bat_loop();
     gps_loop();
+    oled_loop();
+    ui_loop();
+    trace_flush();
 }
@@ -0,0 +1,182 @@
+#include <Arduino.h>
+#include <lmic.h>
+#include "meter.h"
+#include "timebase.h"
+
+/*
+ * Energy accounting.
+ *
+ * Each load (MCU, GPS, OLED, radio, battery ADC) is in exactly one state at a time. The
+ * drivers call meter_set() on every transition and the time spent in each state is
+ * accumulated in LPTIM1 time base ticks, which keep counting in STOP mode. The charge
+ * drawn is the time in each state times its current from the table below.
+ *
+ * Accounting starts with meter_init(), once the LSE runs. Transitions before it only
+ * set the state, the boot time until then is not counted.
+ */
+
+#define METER_TICKS_PER_HOUR ((uint64_t)OSTICKS_PER_SEC * 3600)
+
+struct MeterStateInfo
+{
+    MeterLoad load;
+    const char *name;
+    uint32_t ua;
+};
+
+static const MeterStateInfo meter_states[METER_STATES] = {
+    {METER_MCU, "MCU run", METER_MCU_RUN_UA},
+    {METER_MCU, "MCU sleep", METER_MCU_SLEEP_UA},
+    {METER_MCU, "MCU stop", METER_MCU_STOP_UA},
+    {METER_GPS, "GPS off", 0},
+    {METER_GPS, "GPS sleep", METER_GPS_SLEEP_UA},
+    {METER_GPS, "GPS on", METER_GPS_ON_UA},
+    {METER_OLED, "OLED off", 0},
+    {METER_OLED, "OLED on", METER_OLED_ON_UA},
+    {METER_RADIO, "Radio sleep", METER_RADIO_SLEEP_UA},
+    {METER_RADIO, "Radio standby", METER_RADIO_STANDBY_UA},
+    {METER_RADIO, "Radio RX FSK", METER_RADIO_RX_UA},
+    {METER_RADIO, "Radio RX SF7", METER_RADIO_RX_UA},
+    {METER_RADIO, "Radio RX SF8", METER_RADIO_RX_UA},
+    {METER_RADIO, "Radio RX SF9", METER_RADIO_RX_UA},
+    {METER_RADIO, "Radio RX SF10", METER_RADIO_RX_UA},
+    {METER_RADIO, "Radio RX SF11", METER_RADIO_RX_UA},
+    {METER_RADIO, "Radio RX SF12", METER_RADIO_RX_UA},
+    {METER_RADIO, "Radio TX FSK", METER_RADIO_TX_UA},
+    {METER_RADIO, "Radio TX SF7", METER_RADIO_TX_UA},
+    {METER_RADIO, "Radio TX SF8", METER_RADIO_TX_UA},
+    {METER_RADIO, "Radio TX SF9", METER_RADIO_TX_UA},
+    {METER_RADIO, "Radio TX SF10", METER_RADIO_TX_UA},
+    {METER_RADIO, "Radio TX SF11", METER_RADIO_TX_UA},
+    {METER_RADIO, "Radio TX SF12", METER_RADIO_TX_UA},
+    {METER_ADC, "ADC off", 0},
+    {METER_ADC, "ADC on", METER_ADC_ON_UA},
+};
+
+static const char *const meter_load_names[METER_LOADS] = {"MCU", "GPS", "OLED", "Radio", "ADC"};
+
+static bool meter_started = false;
+static MeterState meter_current[METER_LOADS] = {
+    METER_MCU_RUN, METER_GPS_OFF, METER_OLED_OFF, METER_RADIO_SLEEP, METER_ADC_OFF,
+};
+static uint32_t meter_since[METER_LOADS];
+static uint64_t meter_ticks[METER_STATES];
+
+/**
+ * @brief Adds the time since the last transition of a load to its current state.
+ *
+ * Must be called at least once per time base wrap (19 h), meter_update() does it for
+ * all loads.
+ */
+static void meter_account(MeterLoad load, uint32_t now)
+{
+    meter_ticks[meter_current[load]] += (uint32_t)(now - meter_since[load]);
+    meter_since[load] = now;
+}
+
+/**
+ * @brief Starts the energy accounting.
+ *
+ * Starts the time base if the LMIC did not do it yet, so the LSE must already be
+ * running. Only the first call has an effect: the counters are kept across
+ * Board_Sleep() and the following BoardInit().
+ */
+void meter_init(void)
+{
+    if (meter_started)
+        return;
+
+    timebase_init();
+    uint32_t now = timebase_ticks();
+    for (int i = 0; i < METER_LOADS; i++)
+        meter_since[i] = now;
+    meter_started = true;
+}
+
+/**
+ * @brief Records a state transition of a load.
+ *
+ * The load is the one the state belongs to. Setting the current state again only
+ * accounts the time spent in it so far.
+ *
+ * @param state The new state.
+ */
+void meter_set(MeterState state)
+{
+    MeterLoad load = meter_states[state].load;
+    if (meter_started)
+        meter_account(load, timebase_ticks());
+    meter_current[load] = state;
+}
+
+/**
+ * @brief Accounts the time spent in the current state of all loads.
+ */
+void meter_update(void)
+{
+    if (!meter_started)
+        return;
+
+    uint32_t now = timebase_ticks();
+    for (int i = 0; i < METER_LOADS; i++)
+        meter_account((MeterLoad)i, now);
+}
+
+/**
+ * @brief Computes the charge drawn by a load.
+ *
+ * @param load The load.
+ * @return The charge drawn since meter_init() in uAh.
+ */
+uint32_t meter_uah(MeterLoad load)
+{
+    meter_update();
+    uint64_t sum = 0;
+    for (int s = 0; s < METER_STATES; s++)
+        if (meter_states[s].load == load)
+            sum += meter_ticks[s] * meter_states[s].ua;
+    return sum / METER_TICKS_PER_HOUR;
+}
+
+/**
+ * @brief Computes the charge drawn by the whole board.
+ *
+ * @return The charge drawn since meter_init() in uAh.
+ */
+uint32_t meter_total_uah(void)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < METER_LOADS; i++)
+        total += meter_uah((MeterLoad)i);
+    return total;
+}
+
+/**
+ * @brief Prints the time spent in each state and the charge drawn by each load.
+ */
+void meter_report(void)
+{
+    meter_update();
+    // The MCU is always in one of its states, its ticks add up to the time accounted
+    uint64_t elapsed = 0;
+    for (int s = 0; s < METER_STATES; s++)
+        if (meter_states[s].load == METER_MCU)
+            elapsed += meter_ticks[s];
+
+    Serial.println(F("State           Time (s)    uAh"));
+    for (int s = 0; s < METER_STATES; s++)
+    {
+        if (meter_ticks[s] == 0)
+            continue;
+        Serial.printf("%-14s %9.1f %6lu\n", meter_states[s].name,
+                      (double)meter_ticks[s] / OSTICKS_PER_SEC,
+                      (unsigned long)(meter_ticks[s] * meter_states[s].ua / METER_TICKS_PER_HOUR));
+    }
+    for (int i = 0; i < METER_LOADS; i++)
+        Serial.printf("%-5s %lu uAh\n", meter_load_names[i], (unsigned long)meter_uah((MeterLoad)i));
+
+    uint32_t total = meter_total_uah();
+    double hours = (double)elapsed / METER_TICKS_PER_HOUR;
+    Serial.printf("Total %lu uAh over %.2f h, %.0f uA average\n", (unsigned long)total, hours,
+                  hours > 0 ? total / hours : 0.0);
+}
@@ -0,0 +1,93 @@
+#ifndef __METER_H__
+#define __METER_H__
+
+#include <stdint.h>
+
+// Supply current of each state in uA, at 3.3 V. Override them with the values measured
+// on a given board.
+#ifndef METER_MCU_RUN_UA
+#define METER_MCU_RUN_UA 4500
+#endif
+#ifndef METER_MCU_SLEEP_UA
+#define METER_MCU_SLEEP_UA 1100
+#endif
+#ifndef METER_MCU_STOP_UA
+#define METER_MCU_STOP_UA 2
+#endif
+#ifndef METER_GPS_ON_UA
+#define METER_GPS_ON_UA 6000
+#endif
+#ifndef METER_GPS_SLEEP_UA
+#define METER_GPS_SLEEP_UA 50
+#endif
+#ifndef METER_OLED_ON_UA
+#define METER_OLED_ON_UA 3000
+#endif
+#ifndef METER_RADIO_SLEEP_UA
+#define METER_RADIO_SLEEP_UA 1
+#endif
+#ifndef METER_RADIO_STANDBY_UA
+#define METER_RADIO_STANDBY_UA 1600
+#endif
+#ifndef METER_RADIO_RX_UA
+#define METER_RADIO_RX_UA 11500
+#endif
+// +14 dBm on PA_BOOST
+#ifndef METER_RADIO_TX_UA
+#define METER_RADIO_TX_UA 90000
+#endif
+#ifndef METER_ADC_ON_UA
+#define METER_ADC_ON_UA 200
+#endif
+
+enum MeterLoad
+{
+    METER_MCU,
+    METER_GPS,
+    METER_OLED,
+    METER_RADIO,
+    METER_ADC,
+    METER_LOADS
+};
+
+// States of all the loads. The radio TX and RX states follow the LMIC _sf_t order, so
+// METER_RADIO_TX_FSK + sf is the TX state of spreading factor sf.
+enum MeterState
+{
+    METER_MCU_RUN,
+    METER_MCU_SLEEP,
+    METER_MCU_STOP,
+    METER_GPS_OFF,
+    METER_GPS_SLEEP,
+    METER_GPS_ON,
+    METER_OLED_OFF,
+    METER_OLED_ON,
+    METER_RADIO_SLEEP,
+    METER_RADIO_STANDBY,
+    METER_RADIO_RX_FSK,
+    METER_RADIO_RX_SF7,
+    METER_RADIO_RX_SF8,
+    METER_RADIO_RX_SF9,
+    METER_RADIO_RX_SF10,
+    METER_RADIO_RX_SF11,
+    METER_RADIO_RX_SF12,
+    METER_RADIO_TX_FSK,
+    METER_RADIO_TX_SF7,
+    METER_RADIO_TX_SF8,
+    METER_RADIO_TX_SF9,
+    METER_RADIO_TX_SF10,
+    METER_RADIO_TX_SF11,
+    METER_RADIO_TX_SF12,
+    METER_ADC_OFF,
+    METER_ADC_ON,
+    METER_STATES
+};
+
+void meter_init(void);
+void meter_set(MeterState state);
+void meter_update(void);
+uint32_t meter_uah(MeterLoad load);
+uint32_t meter_total_uah(void);
+void meter_report(void);
+
+#endif /* __METER_H__ */
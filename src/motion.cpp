@@ -0,0 +1,175 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <ICM_20948.h>
+#include <lmic.h>
+#include "config.h"
+#include "motion.h"
+#include "timebase.h"
+
+/*
+ * Stationary/moving state from the wake-on-motion of the ICM-20948.
+ *
+ * Only the accelerometer runs, in low power cycled mode; the gyroscope, the magnetometer
+ * and the I2C master of the IMU are off. Each sample is compared to the previous one and
+ * a change above MOTION_WOM_THRESHOLD on any axis latches WOM_INT in INT_STATUS. The INT
+ * output of the IMU has no MCU pin in config.h, so the latched status is read every
+ * MOTION_POLL_S seconds by an LMIC job. Reading the status clears it.
+ *
+ * The board is moving from boot and becomes stationary after MOTION_STILL_S seconds
+ * without motion. When the IMU does not answer, the board stays moving.
+ */
+
+// Highest bus clock of the IMU, the OLED transport sets its own clock again
+static const uint32_t MOTION_I2C_CLOCK = 400000;
+// Accelerometer sample rate, 1125 / (1 + div) Hz: about 10 Hz
+static const uint16_t MOTION_ACCEL_DIV = 111;
+// Setups tried before giving up on the IMU, one per poll period
+static const uint8_t MOTION_SETUP_TRIES = 3;
+
+static ICM_20948_I2C motion_imu;
+static bool motion_ready = false;
+static uint8_t motion_setup_tries = 0;
+static bool motion_is_moving = true;
+static uint32_t motion_seen_at;
+static osjob_t motion_poll_job;
+static MotionCallback motion_change_cb = nullptr;
+
+/**
+ * @brief Configures the IMU for the wake-on-motion interrupt.
+ *
+ * @return true if the IMU answered and is configured.
+ */
+static bool motion_setup(void)
+{
+    uint8_t mag_mode = AK09916_mode_power_down;
+    ICM_20948_smplrt_t rate = {MOTION_ACCEL_DIV, 0};
+    ICM_20948_ACCEL_INTEL_CTRL_t intel = {};
+    ICM_20948_PWR_MGMT_2_t pwr = {};
+    bool ok = true;
+
+    Wire.setClock(MOTION_I2C_CLOCK);
+    // Bit 0 of the address is the AD0 pin level
+    if (motion_imu.begin(Wire, ICM20948_ADDR & 1) != ICM_20948_Stat_Ok)
+        return false;
+
+    // The default startup runs the magnetometer through the I2C master, stop both
+    motion_imu.writeMag(AK09916_REG_CNTL2, &mag_mode);
+    motion_imu.i2cMasterEnable(false);
+
+    motion_imu.setSampleMode(ICM_20948_Internal_Acc, ICM_20948_Sample_Mode_Cycled);
+    motion_imu.setSampleRate(ICM_20948_Internal_Acc, rate);
+    motion_imu.cfgIntLatch(true);
+    motion_imu.cfgIntAnyReadToClear(false);
+
+    // Compare each sample to the previous one
+    intel.ACCEL_INTEL_EN = 1;
+    intel.ACCEL_INTEL_MODE_INT = 1;
+    motion_imu.setBank(2);
+    ok &= motion_imu.write(AGB2_REG_ACCEL_INTEL_CTRL, (uint8_t *)&intel, 1) == ICM_20948_Stat_Ok;
+    ok &= motion_imu.WOMThreshold(MOTION_WOM_THRESHOLD) == ICM_20948_Stat_Ok;
+    ok &= motion_imu.intEnableWOM(true) == ICM_20948_Stat_Ok;
+
+    // Gyroscope axes off, then the accelerometer in low power mode
+    pwr.DISABLE_GYRO = 0x07;
+    motion_imu.setBank(0);
+    ok &= motion_imu.write(AGB0_REG_PWR_MGMT_2, (uint8_t *)&pwr, 1) == ICM_20948_Stat_Ok;
+    ok &= motion_imu.lowPower(true) == ICM_20948_Stat_Ok;
+
+    // Drop what the setup latched
+    ok &= motion_imu.clearInterrupts() == ICM_20948_Stat_Ok;
+    return ok;
+}
+
+/**
+ * @brief Reads and clears the latched wake-on-motion status.
+ *
+ * @return true if the IMU saw motion since the last read.
+ */
+static bool motion_detected(void)
+{
+    ICM_20948_INT_STATUS_t status = {};
+
+    Wire.setClock(MOTION_I2C_CLOCK);
+    motion_imu.setBank(0);
+    if (motion_imu.read(AGB0_REG_INT_STATUS, (uint8_t *)&status, 1) != ICM_20948_Stat_Ok)
+        return false;
+    return status.WOM_INT;
+}
+
+/**
+ * @brief Updates the state and reports a change.
+ */
+static void motion_set(bool moving)
+{
+    if (moving == motion_is_moving)
+        return;
+    motion_is_moving = moving;
+    if (motion_change_cb != nullptr)
+        motion_change_cb(moving);
+}
+
+/**
+ * @brief Reads the wake-on-motion status, the LMIC job of the poll.
+ *
+ * Until the IMU is configured, it tries the setup instead; the poll stops after
+ * MOTION_SETUP_TRIES failed setups.
+ */
+static void motion_poll(osjob_t *j)
+{
+    uint32_t now = timebase_ticks();
+
+    if (!motion_ready)
+    {
+        motion_setup_tries++;
+        motion_ready = motion_setup();
+        if (motion_ready || motion_setup_tries < MOTION_SETUP_TRIES)
+            os_setTimedCallback(j, os_getTime() + sec2osticks(MOTION_POLL_S), motion_poll);
+        return;
+    }
+    os_setTimedCallback(j, os_getTime() + sec2osticks(MOTION_POLL_S), motion_poll);
+
+    if (motion_detected())
+    {
+        motion_seen_at = now;
+        motion_set(true);
+    }
+    else if ((int32_t)(now - motion_seen_at) >= (int32_t)sec2osticks(MOTION_STILL_S))
+    {
+        motion_set(false);
+    }
+}
+
+/**
+ * @brief Starts the motion detection, after Wire.begin().
+ *
+ * The board starts moving, which is reported if it was stationary before a sleep. The
+ * IMU is configured from the first poll job, so its startup does not delay the boot.
+ */
+void motion_init(void)
+{
+    motion_ready = false;
+    motion_setup_tries = 0;
+    motion_set(true);
+    motion_seen_at = timebase_ticks();
+    os_setCallback(&motion_poll_job, motion_poll);
+}
+
+/**
+ * @brief Retrieves the motion state.
+ *
+ * @return true while moving, or if the IMU does not answer.
+ */
+bool motion_moving(void)
+{
+    return motion_is_moving;
+}
+
+/**
+ * @brief Registers the function called when the board starts or stops moving.
+ *
+ * @param cb The callback, or nullptr; it gets true when the board starts moving.
+ */
+void motion_on_change(MotionCallback cb)
+{
+    motion_change_cb = cb;
+}
@@ -0,0 +1,32 @@
+#ifndef __MOTION_H__
+#define __MOTION_H__
+
+#include <stdint.h>
+
+// Time without motion before the board is stationary
+#ifndef MOTION_STILL_S
+#define MOTION_STILL_S 300
+#endif
+
+// Period of the wake-on-motion status reads
+#ifndef MOTION_POLL_S
+#define MOTION_POLL_S 10
+#endif
+
+// Uplink interval while stationary
+#ifndef MOTION_HEARTBEAT_S
+#define MOTION_HEARTBEAT_S 900
+#endif
+
+// Wake-on-motion threshold, 4 mg per LSB
+#ifndef MOTION_WOM_THRESHOLD
+#define MOTION_WOM_THRESHOLD 20
+#endif
+
+typedef void (*MotionCallback)(bool moving);
+
+void motion_init(void);
+bool motion_moving(void);
+void motion_on_change(MotionCallback cb);
+
+#endif /* __MOTION_H__ */
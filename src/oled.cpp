@@ -1,39 +1,99 @@
 
 #include "oled.h"
+#include "oled_i2c.h"
 #include "config.h"
+#include "meter.h"
 
-U8G2_SSD1306_64X32_1F_F_HW_I2C *u8g2 = nullptr;
+// Contrast once the splash screen has faded in
+#define OLED_CONTRAST 0xFF
+
+// Frame buffer size of the 64x32 panel in 8x8 tiles
+#define OLED_TILES_W 8
+#define OLED_TILES_H 4
+
+#if OLED_I2C_DMA
+static U8G2_SSD1306_64X32_1F_F_HW_I2C_DMA u8g2_display(U8G2_R0, OLED_RESET, IICSCL, IICSDA);
+#else
+static U8G2_SSD1306_64X32_1F_F_HW_I2C u8g2_display(U8G2_R0, OLED_RESET, IICSCL, IICSDA);
+#endif
+U8G2 *u8g2 = nullptr;
+// Frame buffer as last sent to the display RAM, only the tiles that differ are sent
+static uint8_t oled_shadow[OLED_TILES_H * OLED_TILES_W * 8];
+static bool oled_shadow_valid = false;
+static bool oled_fading = false;
+static uint32_t oled_fade_start;
+static uint8_t oled_contrast;
 
 /**
  * @brief Initializes the OLED display.
  *
- * This function sets up the OLED display by creating an instance of the U8G2 library,
- * initializing the display, setting the contrast, clearing the buffer, and configuring
- * the font and display settings. It also displays the device name and a contrast animation.
+ * This function sets up the OLED display by binding the static U8G2 instance,
+ * (re)initializing the display, clearing the buffer, and configuring the font and display
+ * settings. It also displays the device name, sent as a single frame: oled_loop() fades
+ * it in afterwards, so the boot goes on meanwhile.
  */
 void oled_init(void)
 {
-    u8g2 = new U8G2_SSD1306_64X32_1F_F_HW_I2C(U8G2_R0, OLED_RESET, IICSCL, IICSDA);
+    u8g2 = &u8g2_display;
 
+#if OLED_I2C_DMA
+    u8g2->setBusClock(OLED_I2C_CLOCK);
+#endif
     u8g2->begin();
-    u8g2->setContrast(0x00);
-    u8g2->clearBuffer();
+    oled_shadow_valid = false;
+    meter_set(METER_OLED_ON);
     u8g2->setFontMode(1); // Transparent
     u8g2->setFontDirection(0);
+    oled_fading = OLED_SPLASH && OLED_SPLASH_MS > 0;
+    oled_contrast = oled_fading ? 0x00 : OLED_CONTRAST;
+    u8g2->setContrast(oled_contrast);
+#if OLED_SPLASH
+    u8g2->clearBuffer();
     u8g2->setFont(u8g2_font_fub14_tf);
-    char dev_name[5];
-    sprintf(dev_name,"TFM %d",DEV_NAME);
+    char dev_name[8];
+    snprintf(dev_name, sizeof(dev_name), "TFM %d", DEV_NAME);
     u8g2->drawStr(1, 18, dev_name);
-    u8g2->sendBuffer();
-    for (int i = 0; i < 0xFF; i++)
+    oled_flush();
+    oled_fade_start = millis();
+#endif
+
+    u8g2->setFont(u8g2_font_IPAandRUSLCD_tr);
+}
+
+/**
+ * @brief Fades the splash screen in over OLED_SPLASH_MS, without blocking.
+ *
+ * Only the contrast command is sent, so whatever the display shows meanwhile fades in
+ * with it.
+ */
+void oled_loop(void)
+{
+    if (!oled_fading)
+        return;
+
+    uint8_t contrast = OLED_CONTRAST;
+#if OLED_SPLASH_MS > 0
+    uint32_t elapsed = millis() - oled_fade_start;
+    if (elapsed < OLED_SPLASH_MS)
+        contrast = elapsed * OLED_CONTRAST / OLED_SPLASH_MS;
+    else
+#endif
+        oled_fading = false;
+    if (contrast != oled_contrast)
     {
-        u8g2->setContrast(i);
-        u8g2->drawFrame(2, 25, 60, 6);
-        u8g2->drawBox(3, 26, (uint8_t)(0.231 * i), 5);
-        u8g2->sendBuffer();
+        oled_contrast = contrast;
+        u8g2->setContrast(contrast);
     }
+}
 
-    u8g2->setFont(u8g2_font_IPAandRUSLCD_tr);
+/**
+ * @brief Tells whether the splash screen is fading in.
+ *
+ * @return true while oled_loop() has to run, the fade is timed with millis().
+ */
+bool oled_busy(void)
+{
+    return oled_fading;
 }
 
 /**
@@ -46,7 +106,62 @@ void oled_sleep(void) {
   u8g2->clearBuffer();
   u8g2->setFont(u8g2_font_fub14_tf);
   u8g2->drawStr(2, 24, "Sleep");
-  u8g2->sendBuffer();
+  oled_flush();
   delay(3000);
-  u8g2->sleepOn();
+  oled_power(false);
+}
+
+/**
+ * @brief Sends the frame buffer to the display, only the 8x8 tiles that changed.
+ *
+ * Replaces sendBuffer(). The buffer is compared tile by tile with a copy of what was
+ * last sent, and each run of changed tiles of a tile row goes over I2C in one
+ * u8g2_UpdateDisplayArea() transfer. The first flush after oled_init() sends it all.
+ */
+void oled_flush(void)
+{
+    const uint8_t *buf = u8g2->getBufferPtr();
+    if (!oled_shadow_valid)
+    {
+        u8g2->sendBuffer();
+        memcpy(oled_shadow, buf, sizeof(oled_shadow));
+        oled_shadow_valid = true;
+        return;
+    }
+
+    for (uint8_t ty = 0; ty < OLED_TILES_H; ty++)
+    {
+        uint8_t tx = 0;
+        while (tx < OLED_TILES_W)
+        {
+            uint16_t offset = (ty * OLED_TILES_W + tx) * 8;
+            if (memcmp(buf + offset, oled_shadow + offset, 8) == 0)
+            {
+                tx++;
+                continue;
+            }
+            uint8_t first = tx;
+            while (tx < OLED_TILES_W &&
+                   memcmp(buf + (ty * OLED_TILES_W + tx) * 8, oled_shadow + (ty * OLED_TILES_W + tx) * 8, 8) != 0)
+                tx++;
+            u8g2->updateDisplayArea(first, ty, tx - first, 1);
+            memcpy(oled_shadow + offset, buf + offset, (tx - first) * 8);
+        }
+    }
+}
+
+/**
+ * @brief Switches the OLED panel on or off, keeping the display RAM.
+ *
+ * @param on true to switch the panel on, false to put it into sleep mode.
+ */
+void oled_power(bool on)
+{
+    if (u8g2 == nullptr)
+        return;
+    if (on)
+        u8g2->sleepOff();
+    else
+        u8g2->sleepOn();
+    meter_set(on ? METER_OLED_ON : METER_OLED_OFF);
 }
\ No newline at end of file
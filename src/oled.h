@@ -4,8 +4,32 @@
 
 #include <U8g2lib.h>
 
+// Display sent on I2C1 by DMA (oled_i2c.h), 0 sends it through the Wire library
+#ifndef OLED_I2C_DMA
+#define OLED_I2C_DMA 1
+#endif
+
+// I2C clock of the DMA transport: Fast-mode Plus, 400000 for panels that do not keep up
+#ifndef OLED_I2C_CLOCK
+#define OLED_I2C_CLOCK 1000000
+#endif
+
+// Splash screen with the device name at boot and wakeup, 0 skips it
+#ifndef OLED_SPLASH
+#define OLED_SPLASH 1
+#endif
+
+// Contrast fade-in of the splash screen, 0 shows it at full contrast right away
+#ifndef OLED_SPLASH_MS
+#define OLED_SPLASH_MS 1000
+#endif
+
 void oled_init(void);
+void oled_loop(void);
+bool oled_busy(void);
 void oled_sleep(void);
-extern U8G2_SSD1306_64X32_1F_F_HW_I2C *u8g2;
+void oled_power(bool on);
+void oled_flush(void);
+extern U8G2 *u8g2;
 
 #endif /* __OLED_H__ */
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <lmic.h>
+#include "oled_i2c.h"
+#include "meter.h"
+#include "timebase.h"
+
+/*
+ * I2C1 DMA transport of the OLED display for U8x8.
+ *
+ * The byte procedure collects a transfer in a RAM buffer and hands it to DMA1 channel 2
+ * (I2C1_TX), then sleeps until the I2C interrupt reports the stop condition: the core
+ * does not poll the bus byte by byte. A transfer that does not end in OLED_I2C_TIMEOUT_MS
+ * is aborted and I2C1 is initialized again. It shares the I2C1 handle of the Wire
+ * library, so other devices on the bus keep using Wire. The bus clock is set at init, at
+ * Fast-mode Plus when the display bus clock is above 400 kHz, and again before a transfer
+ * when another device on the bus (the IMU, see motion.cpp) changed it.
+ *
+ * The command/data procedure sends the commands of a draw call in one transfer and a
+ * whole tile row of data in another, where u8x8_cad_ssd13xx_fast_i2c() splits the data
+ * into 24 byte transfers to fit the Arduino Wire buffer.
+ */
+
+static DMA_HandleTypeDef hdma_oled_tx;
+static uint8_t oled_i2c_buf[OLED_I2C_BUF_LEN];
+static uint16_t oled_i2c_len = 0;
+// I2C1 timing register value of the display bus clock
+static uint32_t oled_i2c_timing;
+
+/**
+ * @brief DMA1 channel 2 and 3 interrupt handler.
+ *
+ * Serves the transfer complete interrupt of the display transfers, the I2C interrupt
+ * handler of the Wire library ends them.
+ */
+extern "C" void DMA1_Channel2_3_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_oled_tx);
+}
+
+/**
+ * @brief Links DMA1 channel 2 to the I2C1 transmitter.
+ */
+static void oled_i2c_dma_init(I2C_HandleTypeDef *hi2c)
+{
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdma_oled_tx.Instance = DMA1_Channel2;
+    hdma_oled_tx.Init.Request = DMA_REQUEST_6; // I2C1_TX
+    hdma_oled_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_oled_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_oled_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_oled_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_oled_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_oled_tx.Init.Mode = DMA_NORMAL;
+    hdma_oled_tx.Init.Priority = DMA_PRIORITY_LOW;
+    if (HAL_DMA_Init(&hdma_oled_tx) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    __HAL_LINKDMA(hi2c, hdmatx, hdma_oled_tx);
+    HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 2, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+}
+
+/**
+ * @brief Aborts the transfer in progress and initializes I2C1 again.
+ */
+static void oled_i2c_abort(I2C_HandleTypeDef *hi2c)
+{
+    HAL_DMA_Abort(hi2c->hdmatx);
+    HAL_I2C_DeInit(hi2c);
+    HAL_I2C_Init(hi2c);
+}
+
+/**
+ * @brief Sleeps until the transfer in progress ends.
+ *
+ * The state is checked with the interrupts masked, so the end of the transfer cannot
+ * slip in between the check and WFI: a pending interrupt keeps the core awake and is
+ * served once they are unmasked. SysTick keeps running (this is not the sleep of the
+ * LowPower library, which suspends it) and wakes the core every millisecond, the
+ * timeout runs on the LPTIM1 time base.
+ */
+static void oled_i2c_wait(I2C_HandleTypeDef *hi2c)
+{
+    uint32_t start = timebase_ticks();
+    bool busy;
+    do
+    {
+        __disable_irq();
+        busy = HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY;
+        if (busy)
+        {
+            meter_set(METER_MCU_SLEEP);
+            __WFI();
+            meter_set(METER_MCU_RUN);
+        }
+        __enable_irq();
+        if (busy && timebase_ticks() - start >= ms2osticks(OLED_I2C_TIMEOUT_MS))
+        {
+            oled_i2c_abort(hi2c);
+            return;
+        }
+    } while (busy);
+}
+
+/**
+ * @brief U8x8 byte procedure sending on I2C1 by DMA.
+ *
+ * @param u8x8 The display.
+ * @param msg The U8X8_MSG_BYTE_* message.
+ * @param arg_int, arg_ptr The message arguments.
+ * @return 1 if the message is handled, 0 otherwise.
+ */
+extern "C" uint8_t u8x8_byte_stm32_hw_i2c_dma(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    I2C_HandleTypeDef *hi2c = &Wire.getHandle()->handle;
+    switch (msg)
+    {
+    case U8X8_MSG_BYTE_SEND:
+        if (arg_int > OLED_I2C_BUF_LEN - oled_i2c_len)
+            arg_int = OLED_I2C_BUF_LEN - oled_i2c_len;
+        memcpy(oled_i2c_buf + oled_i2c_len, arg_ptr, arg_int);
+        oled_i2c_len += arg_int;
+        break;
+    case U8X8_MSG_BYTE_INIT:
+        if (u8x8->bus_clock == 0)
+            u8x8->bus_clock = u8x8->display_info->i2c_bus_clock_100kHz * 100000UL;
+        Wire.begin();
+        // Once here, u8x8_byte_arduino_hw_i2c() sets it again for every transfer
+        Wire.setClock(u8x8->bus_clock);
+        oled_i2c_timing = hi2c->Init.Timing;
+        if (u8x8->bus_clock > 400000)
+        {
+            __HAL_RCC_SYSCFG_CLK_ENABLE();
+            HAL_I2CEx_EnableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+        }
+        oled_i2c_dma_init(hi2c);
+        break;
+    case U8X8_MSG_BYTE_SET_DC:
+        break;
+    case U8X8_MSG_BYTE_START_TRANSFER:
+        if (hi2c->Init.Timing != oled_i2c_timing)
+            Wire.setClock(u8x8->bus_clock);
+        oled_i2c_len = 0;
+        break;
+    case U8X8_MSG_BYTE_END_TRANSFER:
+        if (HAL_I2C_Master_Transmit_DMA(hi2c, u8x8_GetI2CAddress(u8x8), oled_i2c_buf, oled_i2c_len) == HAL_OK)
+            oled_i2c_wait(hi2c);
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief U8x8 command/data procedure for the SSD13xx controllers on I2C, by tile rows.
+ *
+ * Consecutive commands and their arguments share one transfer (control byte 0x00),
+ * display data goes in transfers of up to OLED_I2C_BUF_LEN - 1 bytes (control byte 0x40).
+ *
+ * @param u8x8 The display.
+ * @param msg The U8X8_MSG_CAD_* message.
+ * @param arg_int, arg_ptr The message arguments.
+ * @return 1 if the message is handled, 0 otherwise.
+ */
+extern "C" uint8_t u8x8_cad_ssd13xx_i2c_rows(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    // Bytes in the command transfer in progress, 0 when there is none
+    static uint16_t cmd_len = 0;
+    uint8_t *p;
+    uint8_t len;
+    switch (msg)
+    {
+    case U8X8_MSG_CAD_SEND_CMD:
+    case U8X8_MSG_CAD_SEND_ARG:
+        if (cmd_len == OLED_I2C_BUF_LEN)
+        {
+            u8x8_byte_EndTransfer(u8x8);
+            cmd_len = 0;
+        }
+        if (cmd_len == 0)
+        {
+            u8x8_byte_StartTransfer(u8x8);
+            u8x8_byte_SendByte(u8x8, 0x00); // Command stream
+            cmd_len = 1;
+        }
+        u8x8_byte_SendByte(u8x8, arg_int);
+        cmd_len++;
+        break;
+    case U8X8_MSG_CAD_SEND_DATA:
+        if (cmd_len != 0)
+            u8x8_byte_EndTransfer(u8x8);
+        cmd_len = 0;
+        p = (uint8_t *)arg_ptr;
+        while (arg_int > 0)
+        {
+            len = arg_int < OLED_I2C_BUF_LEN - 1 ? arg_int : OLED_I2C_BUF_LEN - 1;
+            u8x8_byte_StartTransfer(u8x8);
+            u8x8_byte_SendByte(u8x8, 0x40); // Data stream
+            u8x8_byte_SendBytes(u8x8, len, p);
+            u8x8_byte_EndTransfer(u8x8);
+            arg_int -= len;
+            p += len;
+        }
+        break;
+    case U8X8_MSG_CAD_INIT:
+        // Default address, used by the start transfer message
+        if (u8x8->i2c_address == 255)
+            u8x8->i2c_address = 0x78;
+        return u8x8->byte_cb(u8x8, msg, arg_int, arg_ptr);
+    case U8X8_MSG_CAD_START_TRANSFER:
+        cmd_len = 0;
+        break;
+    case U8X8_MSG_CAD_END_TRANSFER:
+        if (cmd_len != 0)
+            u8x8_byte_EndTransfer(u8x8);
+        cmd_len = 0;
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
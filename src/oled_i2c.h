@@ -0,0 +1,39 @@
+#ifndef __OLED_I2C_H__
+#define __OLED_I2C_H__
+
+#include <U8g2lib.h>
+
+// Largest I2C transfer: the control byte and one 128 pixel wide tile row
+#ifndef OLED_I2C_BUF_LEN
+#define OLED_I2C_BUF_LEN (1 + 128)
+#endif
+
+// Longest wait for a transfer, a stuck bus drops the frame instead of hanging
+#ifndef OLED_I2C_TIMEOUT_MS
+#define OLED_I2C_TIMEOUT_MS 20
+#endif
+
+extern "C" uint8_t u8x8_byte_stm32_hw_i2c_dma(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
+extern "C" uint8_t u8x8_cad_ssd13xx_i2c_rows(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
+
+/**
+ * @brief SSD1306 64x32 with a full frame buffer, sent on I2C1 by DMA.
+ *
+ * Same as U8G2_SSD1306_64X32_1F_F_HW_I2C, with the I2C1 DMA byte procedure and a tile
+ * row sent in one transfer instead of 24 byte chunks.
+ */
+class U8G2_SSD1306_64X32_1F_F_HW_I2C_DMA : public U8G2
+{
+public:
+    U8G2_SSD1306_64X32_1F_F_HW_I2C_DMA(const u8g2_cb_t *rotation, uint8_t reset = U8X8_PIN_NONE,
+                                       uint8_t clock = U8X8_PIN_NONE, uint8_t data = U8X8_PIN_NONE)
+        : U8G2()
+    {
+        u8g2_Setup_ssd1306_i2c_64x32_1f_f(&u8g2, rotation, u8x8_byte_stm32_hw_i2c_dma,
+                                          u8x8_gpio_and_delay_arduino);
+        getU8x8()->cad_cb = u8x8_cad_ssd13xx_i2c_rows;
+        u8x8_SetPin_HW_I2C(getU8x8(), reset, clock, data);
+    }
+};
+
+#endif /* __OLED_I2C_H__ */
@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+#include "payload.h"
+#include "fixlog.h"
+
+/*
+ * Compact uplink format, bit-packed MSB first:
+ *
+ *   type      2   0: no fix, 1: absolute position, 2: position delta
+ *   interior  1
+ *   battery   4   (V - 3.0) / 0.1, clamped to 0..15
+ *   channels  8   Channels used in the last uplinks, B0->Ch0
+ *   ref       4   Absolute frames: their tag. Delta frames: tag of the reference
+ *
+ * Absolute frame: lat, lng (PAYLOAD_POS_BITS each), alt (16, meters + 1000).
+ * Delta frame: dlat, dlng (PAYLOAD_DELTA_BITS each, signed), dalt (8, signed meters).
+ *
+ * Deltas are taken against the last absolute frame acknowledged by the network, so the
+ * decoder always has the reference. An absolute frame is only sent confirmed when it can
+ * become a reference: the previous fix was within delta range of it, so the next ones
+ * likely are too. While the device moves faster than the delta range, every frame is
+ * absolute and an ack would only cost a downlink and the retries. The tag of the
+ * reference is not given to new absolute frames, so the decoder keeps its position
+ * whatever the number of absolute frames sent, or lost, since the ack.
+ *
+ * Batch frame (type 3), several fixes from the fix log, oldest first. The ref field is
+ * replaced by a 6 bit fix count, then each fix starts with a 1 bit flag:
+ *   0: lat, lng (PAYLOAD_POS_BITS each), alt (16, meters + 1000), age (16, seconds)
+ *   1: dlat, dlng (PAYLOAD_DELTA_BITS each), dalt (8), dage (12, seconds), from the
+ *      previous fix of the frame
+ * The age is counted back from the uplink. Batch frames are self-contained.
+ */
+
+#define PAYLOAD_TYPE_NOFIX 0
+#define PAYLOAD_TYPE_ABS 1
+#define PAYLOAD_TYPE_DELTA 2
+#define PAYLOAD_TYPE_BATCH 3
+
+#define PAYLOAD_TAG_MASK 0x0F
+#define PAYLOAD_ALT_OFFSET 1000
+#define PAYLOAD_ALT_MAX 0xFFFF
+#define PAYLOAD_ALT_DELTA_MAX 127
+#define PAYLOAD_DELTA_MAX ((1L << (PAYLOAD_DELTA_BITS - 1)) - 1)
+#define PAYLOAD_AGE_MAX 0xFFFF
+#define PAYLOAD_DAGE_MAX 0xFFF
+#define PAYLOAD_HEADER_BITS 15
+#define PAYLOAD_FIX_ABS_BITS (1 + 2 * PAYLOAD_POS_BITS + 16 + 16)
+#define PAYLOAD_FIX_DELTA_BITS (1 + 2 * PAYLOAD_DELTA_BITS + 8 + 12)
+
+typedef struct
+{
+    uint32_t lat;
+    uint32_t lng;
+    int32_t alt;
+} PayloadPos;
+
+static PayloadPos ref_pos;      // Reference acknowledged by the network
+static bool ref_valid = false;
+static uint8_t ref_tag = 0;
+static PayloadPos pending_pos;  // Last absolute frame sent, waiting for its ack
+static bool pending_valid = false;
+static uint8_t pending_tag = 0;
+static uint8_t next_tag = 0;
+static PayloadPos last_pos;     // Position of the last frame with a fix
+static bool last_valid = false;
+
+static uint8_t *bit_buf;
+static uint16_t bit_pos;
+
+/**
+ * @brief Appends a value to the frame being encoded.
+ *
+ * @param value The value, only its lower bits are written.
+ * @param bits Number of bits to write, MSB first.
+ */
+static void put_bits(uint32_t value, uint8_t bits)
+{
+    while (bits--)
+    {
+        if (value & (1UL << bits))
+            bit_buf[bit_pos >> 3] |= 0x80 >> (bit_pos & 7);
+        bit_pos++;
+    }
+}
+
+/**
+ * @brief Quantizes a coordinate to PAYLOAD_POS_BITS.
+ *
+ * @param deg The coordinate in degrees.
+ * @param span The coordinate range, 180 for latitude and 360 for longitude.
+ * @return The step index, from 0 to 2^PAYLOAD_POS_BITS - 1.
+ */
+static uint32_t quantize(double deg, double span)
+{
+    const uint32_t steps = 1UL << PAYLOAD_POS_BITS;
+    double q = (deg + span / 2) / span * steps;
+    if (q < 0)
+        return 0;
+    if (q >= steps)
+        return steps - 1;
+    return (uint32_t)q;
+}
+
+/**
+ * @brief Tells whether a position can be sent as a delta from another one.
+ */
+static bool in_delta_range(const PayloadPos *pos, const PayloadPos *from)
+{
+    return labs((int32_t)(pos->lat - from->lat)) <= PAYLOAD_DELTA_MAX &&
+           labs((int32_t)(pos->lng - from->lng)) <= PAYLOAD_DELTA_MAX &&
+           labs(pos->alt - from->alt) <= PAYLOAD_ALT_DELTA_MAX;
+}
+
+/**
+ * @brief Writes the part of the header shared by all the frame types.
+ */
+static void put_header(uint8_t type, bool interior, uint8_t channels, float battery)
+{
+    int batt = (int)((battery - 3.0f) * 10 + 0.5f);
+
+    put_bits(type, 2);
+    put_bits(interior, 1);
+    put_bits(batt < 0 ? 0 : (batt > 15 ? 15 : batt), 4);
+    put_bits(channels, 8);
+}
+
+/**
+ * @brief Forgets the position reference.
+ *
+ * The next frame with a fix is sent as an absolute position. Must be called when the
+ * LoRaWAN session is restarted.
+ */
+void payload_reset(void)
+{
+    ref_valid = false;
+    pending_valid = false;
+    last_valid = false;
+}
+
+/**
+ * @brief Encodes an uplink in the compact format.
+ *
+ * @param buf Output buffer, at least PAYLOAD_MAX_SIZE bytes.
+ * @param fix Whether lat, lng and alt hold a new position.
+ * @param lat Latitude in degrees.
+ * @param lng Longitude in degrees.
+ * @param alt Altitude in meters.
+ * @param interior Whether the device is in an interior environment.
+ * @param channels Bitmap of the channels used in the last uplinks.
+ * @param battery Battery voltage.
+ * @param confirmed Set when the frame must be sent as a confirmed uplink.
+ * @return The frame size in bytes.
+ */
+uint8_t payload_encode(uint8_t *buf, bool fix, double lat, double lng, double alt,
+                       bool interior, uint8_t channels, float battery, bool *confirmed)
+{
+    PayloadPos pos;
+    uint8_t type = PAYLOAD_TYPE_NOFIX;
+
+    *confirmed = false;
+    if (fix)
+    {
+        pos.lat = quantize(lat, 180);
+        pos.lng = quantize(lng, 360);
+        pos.alt = (int32_t)(alt < 0 ? alt - 0.5 : alt + 0.5);
+        type = ref_valid && in_delta_range(&pos, &ref_pos) ? PAYLOAD_TYPE_DELTA : PAYLOAD_TYPE_ABS;
+        *confirmed = type == PAYLOAD_TYPE_ABS && (!last_valid || in_delta_range(&pos, &last_pos));
+        last_pos = pos;
+        last_valid = true;
+    }
+
+    memset(buf, 0, PAYLOAD_MAX_SIZE);
+    bit_buf = buf;
+    bit_pos = 0;
+    put_header(type, interior, channels, battery);
+
+    if (type == PAYLOAD_TYPE_ABS)
+    {
+        int32_t alt_code = pos.alt + PAYLOAD_ALT_OFFSET;
+        put_bits(next_tag, 4);
+        put_bits(pos.lat, PAYLOAD_POS_BITS);
+        put_bits(pos.lng, PAYLOAD_POS_BITS);
+        put_bits(alt_code < 0 ? 0 : (alt_code > PAYLOAD_ALT_MAX ? PAYLOAD_ALT_MAX : alt_code), 16);
+        pending_pos = pos;
+        pending_valid = *confirmed;
+        pending_tag = next_tag;
+        next_tag = (next_tag + 1) & PAYLOAD_TAG_MASK;
+        if (ref_valid && next_tag == ref_tag)
+            next_tag = (next_tag + 1) & PAYLOAD_TAG_MASK;
+    }
+    else
+    {
+        put_bits(ref_valid ? ref_tag : 0, 4);
+        if (type == PAYLOAD_TYPE_DELTA)
+        {
+            put_bits(pos.lat - ref_pos.lat, PAYLOAD_DELTA_BITS);
+            put_bits(pos.lng - ref_pos.lng, PAYLOAD_DELTA_BITS);
+            put_bits((uint32_t)(pos.alt - ref_pos.alt), 8);
+        }
+        pending_valid = false;
+    }
+
+    return (bit_pos + 7) >> 3;
+}
+
+/**
+ * @brief Reads a fix of the log for a batch frame.
+ *
+ * @param i Index of the fix in the log.
+ * @param now Time of the uplink.
+ * @param prev The previous fix of the frame, nullptr for the first one.
+ * @param prev_age The age of the previous fix.
+ * @param pos Set to the quantized position.
+ * @param age Set to the age of the fix in seconds.
+ * @return Whether the fix is encoded as a delta from prev.
+ */
+static bool batch_fix(uint16_t i, uint32_t now, const PayloadPos *prev, uint32_t prev_age,
+                      PayloadPos *pos, uint32_t *age)
+{
+    FixRecord fix;
+
+    fixlog_get(i, &fix);
+    pos->lat = quantize(fix.lat / 1e6, 180);
+    pos->lng = quantize(fix.lng / 1e6, 360);
+    pos->alt = fix.alt;
+    *age = fixlog_age(&fix, now);
+    if (*age > PAYLOAD_AGE_MAX)
+        *age = PAYLOAD_AGE_MAX;
+    return prev != nullptr && in_delta_range(pos, prev) && *age <= prev_age &&
+           prev_age - *age <= PAYLOAD_DAGE_MAX;
+}
+
+/**
+ * @brief Encodes the oldest fixes of the fix log in a batch frame.
+ *
+ * As many fixes as fit in max_len are packed. Each one is a delta from the previous
+ * fix when it is in range, an absolute position otherwise.
+ *
+ * @param buf Output buffer, at least max_len bytes.
+ * @param max_len Maximum frame size in bytes, at most PAYLOAD_BATCH_MAX_SIZE.
+ * @param interior Whether the device is in an interior environment.
+ * @param channels Bitmap of the channels used in the last uplinks.
+ * @param battery Battery voltage.
+ * @param fixes Set to the number of fixes packed.
+ * @return The frame size in bytes.
+ */
+uint8_t payload_encode_batch(uint8_t *buf, uint8_t max_len, bool interior, uint8_t channels,
+                             float battery, uint16_t *fixes)
+{
+    uint32_t now = fixlog_now();
+    uint16_t count = 0;
+    uint16_t available = fixlog_count();
+    uint16_t bits = PAYLOAD_HEADER_BITS + 6;
+    PayloadPos pos, prev;
+    uint32_t age, prev_age = 0;
+
+    // First pass: count the fixes that fit, the count goes in the header
+    while (count < PAYLOAD_BATCH_MAX_FIXES && count < available)
+    {
+        bool delta = batch_fix(count, now, count ? &prev : nullptr, prev_age, &pos, &age);
+        uint16_t fix_bits = delta ? PAYLOAD_FIX_DELTA_BITS : PAYLOAD_FIX_ABS_BITS;
+        if (bits + fix_bits > max_len * 8)
+            break;
+        bits += fix_bits;
+        prev = pos;
+        prev_age = age;
+        count++;
+    }
+
+    memset(buf, 0, max_len);
+    bit_buf = buf;
+    bit_pos = 0;
+    put_header(PAYLOAD_TYPE_BATCH, interior, channels, battery);
+    put_bits(count, 6);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        bool delta = batch_fix(i, now, i ? &prev : nullptr, prev_age, &pos, &age);
+        put_bits(delta, 1);
+        if (delta)
+        {
+            put_bits(pos.lat - prev.lat, PAYLOAD_DELTA_BITS);
+            put_bits(pos.lng - prev.lng, PAYLOAD_DELTA_BITS);
+            put_bits((uint32_t)(pos.alt - prev.alt), 8);
+            put_bits(prev_age - age, 12);
+        }
+        else
+        {
+            int32_t alt_code = pos.alt + PAYLOAD_ALT_OFFSET;
+            put_bits(pos.lat, PAYLOAD_POS_BITS);
+            put_bits(pos.lng, PAYLOAD_POS_BITS);
+            put_bits(alt_code < 0 ? 0 : (alt_code > PAYLOAD_ALT_MAX ? PAYLOAD_ALT_MAX : alt_code), 16);
+            put_bits(age, 16);
+        }
+        prev = pos;
+        prev_age = age;
+    }
+
+    *fixes = count;
+    return (bit_pos + 7) >> 3;
+}
+
+/**
+ * @brief Reports that the last uplink was acknowledged by the network.
+ *
+ * If it was an absolute position, it becomes the reference of the next deltas.
+ */
+void payload_ack(void)
+{
+    if (pending_valid)
+    {
+        ref_pos = pending_pos;
+        ref_tag = pending_tag;
+        ref_valid = true;
+        pending_valid = false;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef __PAYLOAD_H__
+#define __PAYLOAD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Build with -D PAYLOAD_COMPACT to send the compact format instead of CayenneLPP
+#define PAYLOAD_LPP_PORT 1
+#define PAYLOAD_COMPACT_PORT 2
+
+// Absolute position resolution: latitude 180 deg and longitude 360 deg over 2^bits steps
+#ifndef PAYLOAD_POS_BITS
+#define PAYLOAD_POS_BITS 24
+#endif
+// Signed position delta, in absolute position steps
+#ifndef PAYLOAD_DELTA_BITS
+#define PAYLOAD_DELTA_BITS 12
+#endif
+
+#if PAYLOAD_POS_BITS > 31 || PAYLOAD_DELTA_BITS >= PAYLOAD_POS_BITS
+#error "Invalid compact payload resolution"
+#endif
+
+// Maximum size of a compact frame: 19 bits header and an absolute position
+#define PAYLOAD_MAX_SIZE ((19 + 2 * PAYLOAD_POS_BITS + 16 + 7) / 8)
+// Maximum size of a batch frame, the EU868 payload limit at DR5
+#define PAYLOAD_BATCH_MAX_SIZE 242
+#define PAYLOAD_BATCH_MAX_FIXES 63
+
+void payload_reset(void);
+uint8_t payload_encode(uint8_t *buf, bool fix, double lat, double lng, double alt,
+                       bool interior, uint8_t channels, float battery, bool *confirmed);
+void payload_ack(void);
+uint8_t payload_encode_batch(uint8_t *buf, uint8_t max_len, bool interior, uint8_t channels,
+                             float battery, uint16_t *fixes);
+
+#endif /* __PAYLOAD_H__ */
@@ -0,0 +1,217 @@
+#include <Arduino.h>
+#include <lmic.h>
+#include "session.h"
+
+/*
+ * LoRaWAN session records in the data EEPROM.
+ *
+ * Each save writes a full record to the slot after the newest one, the CRC word being
+ * written last. A power failure while writing leaves an invalid record and the previous
+ * one is still used. On boot the valid record with the highest sequence number wins.
+ *
+ * The uplink counter stored is a reservation: the next SESSION_FCNT_BLOCK frames can be
+ * sent without writing, and a restored session continues from the end of the block so
+ * that a frame counter is never reused. The downlink counter is saved exactly, as soon as
+ * a downlink advanced it, so that a replayed downlink is still rejected after a reset.
+ * Downlinks are rare (acks of the few confirmed uplinks, commands), the writes they add
+ * hardly count in the EEPROM wear.
+ */
+
+#define SESSION_MAGIC 0x53534E4C // Marks a written record
+#define SESSION_BASE DATA_EEPROM_BASE
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t netid;
+    uint32_t devaddr;
+    uint8_t nwkKey[16];
+    uint8_t artKey[16];
+    uint32_t seqnoUp; // Reserved up to this value
+    uint32_t seqnoDn;
+    uint32_t channelFreq[MAX_CHANNELS];
+    uint16_t channelDrMap[MAX_CHANNELS];
+    uint16_t channelMap;
+    uint8_t datarate;
+    int8_t adrTxPow;
+    uint8_t rx1DrOffset;
+    uint8_t dn2Dr;
+    uint8_t rxDelay;
+    uint8_t reserved;
+    uint32_t crc;
+} SessionRecord;
+
+static_assert(sizeof(SessionRecord) % 4 == 0, "SessionRecord must be word aligned");
+static_assert(SESSION_SLOTS * sizeof(SessionRecord) <= SESSION_EEPROM_SIZE,
+              "Session records do not fit in their EEPROM area");
+
+static int session_slot = -1; // Slot of the newest record, -1 if none
+static uint32_t session_seq = 0;
+static uint32_t session_fcnt_limit = 0;
+static uint32_t session_seqno_dn = 0; // Downlink counter of the newest record
+
+/**
+ * @brief Computes the CRC-32 of a record, without its CRC word.
+ *
+ * @param rec The record.
+ * @return The CRC-32.
+ */
+static uint32_t session_crc(const SessionRecord *rec)
+{
+    const uint8_t *p = (const uint8_t *)rec;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < offsetof(SessionRecord, crc); i++)
+    {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Returns the record stored in a slot, mapped in memory.
+ *
+ * @param slot The slot index.
+ * @return Pointer to the record in the EEPROM.
+ */
+static const SessionRecord *session_record(int slot)
+{
+    return (const SessionRecord *)(SESSION_BASE + slot * sizeof(SessionRecord));
+}
+
+/**
+ * @brief Finds the newest valid record.
+ *
+ * @return The slot of the newest record, or -1 if there is none.
+ */
+static int session_find(void)
+{
+    int newest = -1;
+    for (int slot = 0; slot < SESSION_SLOTS; slot++)
+    {
+        const SessionRecord *rec = session_record(slot);
+        if (rec->magic != SESSION_MAGIC || rec->crc != session_crc(rec))
+            continue;
+        if (newest < 0 || (int32_t)(rec->seq - session_record(newest)->seq) > 0)
+            newest = slot;
+    }
+    return newest;
+}
+
+/**
+ * @brief Writes a record to the next slot.
+ *
+ * @param rec The record, its sequence number and CRC are filled in here.
+ */
+static void session_write(SessionRecord *rec)
+{
+    int slot = (session_slot + 1) % SESSION_SLOTS;
+    uint32_t addr = SESSION_BASE + slot * sizeof(SessionRecord);
+    const uint32_t *words = (const uint32_t *)rec;
+
+    rec->magic = SESSION_MAGIC;
+    rec->seq = ++session_seq;
+    rec->crc = session_crc(rec);
+
+    HAL_FLASHEx_DATAEEPROM_Unlock();
+    // Invalidate the slot first, the CRC word is written last
+    HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, addr + offsetof(SessionRecord, crc), 0);
+    for (size_t i = 0; i < sizeof(SessionRecord) / 4; i++)
+        HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, addr + i * 4, words[i]);
+    HAL_FLASHEx_DATAEEPROM_Lock();
+
+    session_slot = slot;
+}
+
+/**
+ * @brief Restores the LoRaWAN session saved in EEPROM.
+ *
+ * Must be called after LMIC_reset(). The uplink counter continues after the block that
+ * was reserved, the channel plan and data rate are the ones of the saved session.
+ *
+ * @return True if a session was restored, false if the device has to join.
+ */
+bool session_restore(void)
+{
+    session_slot = session_find();
+    if (session_slot < 0)
+        return false;
+
+    SessionRecord rec = *session_record(session_slot);
+    session_seq = rec.seq;
+
+    LMIC_setSession(rec.netid, rec.devaddr, rec.nwkKey, rec.artKey);
+    memcpy(LMIC.channelFreq, rec.channelFreq, sizeof(LMIC.channelFreq));
+    memcpy(LMIC.channelDrMap, rec.channelDrMap, sizeof(LMIC.channelDrMap));
+    LMIC.channelMap = rec.channelMap;
+    LMIC.rx1DrOffset = rec.rx1DrOffset;
+    LMIC.dn2Dr = rec.dn2Dr;
+    LMIC.rxDelay = rec.rxDelay;
+    LMIC_setDrTxpow(rec.datarate, rec.adrTxPow);
+    LMIC_setSeqnoUp(rec.seqnoUp);
+    LMIC.seqnoDn = rec.seqnoDn;
+
+    // Reserve the next block before the first uplink
+    session_fcnt_limit = 0;
+    session_update();
+    Serial.printf("Session restored, DevAddr %08lx, FCnt %lu\n", (unsigned long)rec.devaddr,
+                  (unsigned long)rec.seqnoUp);
+    return true;
+}
+
+/**
+ * @brief Saves the current LoRaWAN session to EEPROM.
+ *
+ * Reserves the next SESSION_FCNT_BLOCK uplink counters.
+ */
+void session_save(void)
+{
+    SessionRecord rec;
+
+    memset(&rec, 0, sizeof(rec));
+    LMIC_getSessionKeys(&rec.netid, &rec.devaddr, rec.nwkKey, rec.artKey);
+    session_fcnt_limit = LMIC_getSeqnoUp() + SESSION_FCNT_BLOCK;
+    rec.seqnoUp = session_fcnt_limit;
+    rec.seqnoDn = LMIC.seqnoDn;
+    session_seqno_dn = rec.seqnoDn;
+    memcpy(rec.channelFreq, LMIC.channelFreq, sizeof(rec.channelFreq));
+    memcpy(rec.channelDrMap, LMIC.channelDrMap, sizeof(rec.channelDrMap));
+    rec.channelMap = LMIC.channelMap;
+    rec.datarate = LMIC.datarate;
+    rec.adrTxPow = LMIC.adrTxPow;
+    rec.rx1DrOffset = LMIC.rx1DrOffset;
+    rec.dn2Dr = LMIC.dn2Dr;
+    rec.rxDelay = LMIC.rxDelay;
+    session_write(&rec);
+}
+
+/**
+ * @brief Saves the session when the reserved uplink counters are used up or a downlink
+ * was received.
+ *
+ * Called after each uplink, it only writes the EEPROM once every SESSION_FCNT_BLOCK
+ * frames or when the downlink counter advanced. Nothing is written if there is no saved
+ * session (not joined or erased).
+ */
+void session_update(void)
+{
+    if (session_slot < 0)
+        return;
+    if ((int32_t)(LMIC_getSeqnoUp() - session_fcnt_limit) >= 0 || LMIC.seqnoDn != session_seqno_dn)
+        session_save();
+}
+
+/**
+ * @brief Invalidates the saved session, the next boot joins again.
+ */
+void session_erase(void)
+{
+    HAL_FLASHEx_DATAEEPROM_Unlock();
+    for (int slot = 0; slot < SESSION_SLOTS; slot++)
+        HAL_FLASHEx_DATAEEPROM_Erase(SESSION_BASE + slot * sizeof(SessionRecord) + offsetof(SessionRecord, magic));
+    HAL_FLASHEx_DATAEEPROM_Lock();
+    session_slot = -1;
+    session_fcnt_limit = 0;
+}
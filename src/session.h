@@ -0,0 +1,18 @@
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <stdint.h>
+
+// Uplink frame counters reserved in EEPROM at once
+#define SESSION_FCNT_BLOCK 64
+// Records rotated over to spread the EEPROM wear
+#define SESSION_SLOTS 16
+// Data EEPROM bytes reserved for the session records, from DATA_EEPROM_BASE
+#define SESSION_EEPROM_SIZE 3072
+
+bool session_restore(void);
+void session_save(void);
+void session_update(void);
+void session_erase(void);
+
+#endif /* __SESSION_H__ */
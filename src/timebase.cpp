@@ -0,0 +1,96 @@
+#include <Arduino.h>
+#include <lmic.h>
+#include "timebase.h"
+
+static volatile uint32_t lptim_overflows = 0;
+static bool timebase_started = false;
+
+/**
+ * @brief LPTIM1 interrupt handler.
+ *
+ * Extends the 16-bit LPTIM1 counter in software on every auto-reload match.
+ */
+extern "C" void LPTIM1_IRQHandler(void)
+{
+    if (LPTIM1->ISR & LPTIM_ISR_ARRM)
+    {
+        LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+        lptim_overflows++;
+    }
+}
+
+/**
+ * @brief Reads the LPTIM1 counter.
+ *
+ * The counter runs from the asynchronous LSE clock, so it has to be read until two
+ * consecutive reads match.
+ *
+ * @return The current LPTIM1 counter value.
+ */
+static uint16_t lptim_count(void)
+{
+    uint16_t prev;
+    uint16_t cnt = LPTIM1->CNT;
+    do
+    {
+        prev = cnt;
+        cnt = LPTIM1->CNT;
+    } while (cnt != prev);
+    return cnt;
+}
+
+/**
+ * @brief Starts the low power time base.
+ *
+ * LPTIM1 is clocked from the 32.768 kHz LSE and keeps counting in STOP mode, so the
+ * LMIC time base does not stop while the MCU sleeps. The LSE must already be running
+ * (it is started together with the RTC in BoardInit()). The counter is never reset, so
+ * this function can be called again after every os_init().
+ */
+void timebase_init(void)
+{
+    if (timebase_started)
+        return;
+
+    __HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSE);
+    __HAL_RCC_LPTIM1_CLK_ENABLE();
+
+    // Internal clock, no prescaler, software start. IER is only writable while disabled.
+    LPTIM1->CFGR = 0;
+    LPTIM1->IER = LPTIM_IER_ARRMIE;
+    LPTIM1->CR = LPTIM_CR_ENABLE;
+    LPTIM1->ARR = 0xFFFF;
+    while (!(LPTIM1->ISR & LPTIM_ISR_ARROK))
+        ;
+    LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+    LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+
+    // LPTIM1 wakes the MCU from STOP through EXTI line 29
+    EXTI->IMR |= EXTI_IMR_IM29;
+    HAL_NVIC_SetPriority(LPTIM1_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+
+    timebase_started = true;
+}
+
+/**
+ * @brief Returns the time base in LMIC ticks.
+ *
+ * Safe to call with interrupts disabled: an overflow that is pending but not yet
+ * serviced is taken into account.
+ *
+ * @return Ticks (OSTICKS_PER_SEC per second) since timebase_init().
+ */
+uint32_t timebase_ticks(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t overflows = lptim_overflows;
+    uint16_t cnt = lptim_count();
+    if ((LPTIM1->ISR & LPTIM_ISR_ARRM) && cnt < 0x8000)
+        overflows++;
+    __set_PRIMASK(primask);
+
+    uint64_t counts = ((uint64_t)overflows << 16) | cnt;
+    return (uint32_t)((counts * OSTICKS_PER_SEC) >> 15);
+}
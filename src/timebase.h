@@ -0,0 +1,9 @@
+#ifndef __TIMEBASE_H__
+#define __TIMEBASE_H__
+
+#include <stdint.h>
+
+void timebase_init(void);
+uint32_t timebase_ticks(void);
+
+#endif /* __TIMEBASE_H__ */
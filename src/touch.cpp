@@ -1,23 +1,108 @@
 #include "config.h"
+#include "touch.h"
 #include "STM32LowPower.h"
+#include <OneButton.h>
+
+static const unsigned TOUCH_CLICK_MS = 400;
+static const unsigned TOUCH_LONG_PRESS_MS = 3000;
+
+// TTP223 output is active high and push-pull, no pull-up needed
+static OneButton touchButton(TOUCH_PAD_PIN, false, false);
+static TouchEvent touch_event = TOUCH_NONE;
+static volatile bool touch_woken = false;
+
+static void touch_on_click(void)
+{
+    touch_event = TOUCH_CLICK;
+}
+
+static void touch_on_double_click(void)
+{
+    touch_event = TOUCH_DOUBLE_CLICK;
+}
+
+static void touch_on_long_press(void)
+{
+    touch_event = TOUCH_LONG_PRESS;
+}
+
+/**
+ * @brief Touch pad interrupt handler.
+ *
+ * Only records the press; the gesture state machine runs from touch_loop(). The
+ * interrupt itself is what wakes the MCU from STOP mode.
+ */
+static void touch_isr(void)
+{
+    touch_woken = true;
+}
 
 /**
- * @brief Checks the touchpad input and calculates the press duration.
+ * @brief Initializes the touch pad and its gesture state machine.
  *
- * This function checks if the touchpad is pressed and calculates the duration of the press.
- * If the touchpad is pressed for more than 3 seconds, it breaks the loop and returns the
- * total press duration in milliseconds. If the touchpad is not pressed, it returns 0.
+ * Powers the TTP223, configures the gestures (click, double click and a 3 seconds long
+ * press) and registers the touch pad as an interrupt wakeup source.
+ */
+void touch_init(void)
+{
+    pinMode(TTP223_VDD_PIN, OUTPUT);
+    pinMode(TOUCH_PAD_PIN, INPUT);
+    digitalWrite(TTP223_VDD_PIN, HIGH);
+
+    touchButton.reset();
+    touchButton.setClickTicks(TOUCH_CLICK_MS);
+    touchButton.setPressTicks(TOUCH_LONG_PRESS_MS);
+    touchButton.attachClick(touch_on_click);
+    touchButton.attachDoubleClick(touch_on_double_click);
+    touchButton.attachLongPressStart(touch_on_long_press);
+    touch_event = TOUCH_NONE;
+
+    LowPower.attachInterruptWakeup(TOUCH_PAD_PIN, touch_isr, RISING, DEEP_SLEEP_MODE);
+}
+
+/**
+ * @brief Advances the gesture state machine.
+ *
+ * Never blocks: it samples the touch pad once and returns the gesture completed since
+ * the last call, if any.
+ *
+ * @return The detected gesture, or TOUCH_NONE.
+ */
+TouchEvent touch_loop(void)
+{
+    touchButton.tick();
+    TouchEvent ev = touch_event;
+    touch_event = TOUCH_NONE;
+    return ev;
+}
+
+/**
+ * @brief Tells whether a gesture is in progress.
+ *
+ * The gesture timing relies on millis(), which stops in STOP mode, so the MCU must
+ * not be stopped until this returns true.
+ *
+ * @return true if the touch pad is released and no gesture is pending.
+ */
+bool touch_idle(void)
+{
+    return touchButton.isIdle() && !digitalRead(TOUCH_PAD_PIN);
+}
+
+/**
+ * @brief Forgets any touch pad press seen so far.
+ */
+void touch_clear_wakeup(void)
+{
+    touch_woken = false;
+}
+
+/**
+ * @brief Tells whether the touch pad was pressed since touch_clear_wakeup().
  *
- * @return The duration of the touchpad press in milliseconds, or 0 if not pressed.
+ * @return true if the touch pad was pressed.
  */
-int TouchCallback(void) {
-  int TouchMillis = millis();
-  if (digitalRead(TOUCH_PAD_PIN)) {
-    while (digitalRead(TOUCH_PAD_PIN)) {
-      if ((int)millis() - TouchMillis > 3000)
-        break;
-    }
-    return ((int)millis() - TouchMillis);
-  }
-  return 0;
-}
\ No newline at end of file
+bool touch_wakeup(void)
+{
+    return touch_woken;
+}
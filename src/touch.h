@@ -1 +1,18 @@
-int TouchCallback(void);
\ No newline at end of file
+#ifndef __TOUCH_H__
+#define __TOUCH_H__
+
+enum TouchEvent
+{
+    TOUCH_NONE,
+    TOUCH_CLICK,
+    TOUCH_DOUBLE_CLICK,
+    TOUCH_LONG_PRESS,
+};
+
+void touch_init(void);
+TouchEvent touch_loop(void);
+bool touch_idle(void);
+void touch_clear_wakeup(void);
+bool touch_wakeup(void);
+
+#endif /* __TOUCH_H__ */
@@ -0,0 +1,124 @@
+#include <Arduino.h>
+#include "trace.h"
+#include "timebase.h"
+
+/*
+ * Binary trace log.
+ *
+ * trace() stores the event id, the time base and three integer arguments in a RAM ring,
+ * with interrupts masked for a few instructions only, so it can be called from any
+ * context. trace_flush() sends the records on the serial port when a host listens, the
+ * formatting is done on the host by tools/trace_decoder.py. Records wait in the ring
+ * while no host is attached; once it is full the oldest are dropped and counted.
+ *
+ * A record is sent as TRACE_FRAME_LEN bytes, all with bit 7 set so they cannot be
+ * mistaken for the ASCII text printed on the same port. The first byte is 0xC0 | event
+ * id, the only one with bit 6 set, so the decoder resyncs on it after a lost byte. The
+ * time and the arguments follow in 0x80 | 6 bits per byte, least significant first.
+ */
+
+#define TRACE_VALUE_BYTES 6 // ceil(32 / 6)
+#define TRACE_FRAME_LEN (1 + 4 * TRACE_VALUE_BYTES)
+
+struct TraceRecord
+{
+    uint32_t time;
+    int32_t args[3];
+    uint8_t event;
+};
+
+static TraceRecord trace_ring[TRACE_SIZE];
+static uint16_t trace_head = 0;
+static uint16_t trace_count = 0;
+static uint32_t trace_dropped = 0;
+
+/**
+ * @brief Records an event.
+ *
+ * @param event The event.
+ * @param a, b, c The arguments, as many as the event format of trace.h uses.
+ */
+void trace(TraceEvent event, int32_t a, int32_t b, int32_t c)
+{
+    uint32_t time = timebase_ticks();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TraceRecord &r = trace_ring[trace_head];
+    trace_head = (trace_head + 1) % TRACE_SIZE;
+    if (trace_count < TRACE_SIZE)
+        trace_count++;
+    else
+        trace_dropped++;
+    r.time = time;
+    r.args[0] = a;
+    r.args[1] = b;
+    r.args[2] = c;
+    r.event = event;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Appends a 32-bit value to a frame, 6 bits per byte.
+ */
+static uint8_t *trace_put(uint8_t *p, uint32_t value)
+{
+    for (int i = 0; i < TRACE_VALUE_BYTES; i++)
+    {
+        *p++ = 0x80 | (value & 0x3F);
+        value >>= 6;
+    }
+    return p;
+}
+
+/**
+ * @brief Sends a record on the serial port.
+ */
+static void trace_send(const TraceRecord &r)
+{
+    uint8_t frame[TRACE_FRAME_LEN];
+    uint8_t *p = frame;
+    *p++ = 0xC0 | r.event;
+    p = trace_put(p, r.time);
+    for (int i = 0; i < 3; i++)
+        p = trace_put(p, r.args[i]);
+    Serial.write(frame, sizeof(frame));
+}
+
+/**
+ * @brief Sends the pending records on the serial port, oldest first.
+ *
+ * Does nothing while no host has the port open. A TRACE_DROPPED record goes first when
+ * records were lost since the last flush.
+ */
+void trace_flush(void)
+{
+    if (!Serial)
+        return;
+
+    TraceRecord r;
+    for (;;)
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint32_t dropped = trace_dropped;
+        bool pending = trace_count > 0;
+        if (pending)
+        {
+            r = trace_ring[(trace_head + TRACE_SIZE - trace_count) % TRACE_SIZE];
+            trace_count--;
+        }
+        trace_dropped = 0;
+        __set_PRIMASK(primask);
+
+        if (dropped)
+        {
+            TraceRecord d = {pending ? r.time : timebase_ticks(), {(int32_t)dropped, 0, 0},
+                             TRACE_DROPPED};
+            trace_send(d);
+        }
+        if (!pending)
+            break;
+        trace_send(r);
+    }
+}
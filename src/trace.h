@@ -0,0 +1,57 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+// Records kept until trace_flush() sends them, the oldest are overwritten
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 64
+#endif
+
+// Trace events. tools/trace_decoder.py reads this list: the string after each event is
+// the printf format of its arguments. Add new events at the end.
+enum TraceEvent
+{
+    TRACE_DROPPED,            // "%d trace records dropped"
+    TRACE_TX_CHANNELS,        // "Channel next TX: %d, channels used: 0x%x"
+    TRACE_BATTERY,            // "Battery: %d mV, %d %%"
+    TRACE_PENDING,            // "Pending fixes: %d, max payload: %d"
+    TRACE_ENERGY,             // "Energy: MCU %d, GPS %d, OLED %d uAh"
+    TRACE_ENERGY_RADIO,       // "Energy: radio %d, ADC %d, total %d uAh"
+    TRACE_NOT_JOINED,         // "Not joined yet"
+    TRACE_TX_BUSY,            // "OP_TXRXPEND, not sending"
+    TRACE_SENDING,            // "Sending %d bytes on port %d"
+    TRACE_EV_TXCOMPLETE,      // "EV_TXCOMPLETE (includes waiting for RX windows), flags 0x%x"
+    TRACE_ACK,                // "Received ack"
+    TRACE_DOWNLINK,           // "Downlink on port %d, %d bytes, first 0x%02x"
+    TRACE_INTERIOR,           // "Interior"
+    TRACE_EXTERIOR,           // "Exterior"
+    TRACE_RX_PAYLOAD_ERR,     // "RX_PAYLOAD_ERR"
+    TRACE_NEXT_TX,            // "Airtime budget left: %d ms, next TX in %d s"
+    TRACE_EV_JOINING,         // "EV_JOINING: -> Joining..."
+    TRACE_EV_JOIN_FAILED,     // "EV_JOIN_FAILED: -> Joining failed"
+    TRACE_EV_JOINED,          // "EV_JOINED"
+    TRACE_EV_RXCOMPLETE,      // "EV_RXCOMPLETE"
+    TRACE_EV_LINK_DEAD,       // "EV_LINK_DEAD"
+    TRACE_EV_LINK_ALIVE,      // "EV_LINK_ALIVE"
+    TRACE_EV_TXSTART,         // "EV_TXSTART, channel %d, DR%d"
+    TRACE_EV_JOIN_TXCOMPLETE, // "EV_JOIN_TXCOMPLETE, no join accept"
+    TRACE_EV_UNKNOWN,         // "Unknown event (%d)"
+    TRACE_ADR_SET,            // "ADR: DR%d -> DR%d, %d dBm"
+    TRACE_ADR_DOWNLINK,       // "Downlink RSSI %d dBm, SNR %d dB, margin %d dB"
+    TRACE_LINKCHECK,          // "LinkCheck: margin %d dB, %d gateways"
+    TRACE_LINKCHECK_NONE,     // "LinkCheck: no answer"
+    TRACE_GPS_SLEEP,          // "GPS SLEEP!!"
+    TRACE_BOOT,               // "Boot to first TX: %d ms"
+    TRACE_MOVING,             // "Moving"
+    TRACE_STATIONARY,         // "Stationary"
+    TRACE_GPS_OVERRUN,        // "GPS: %d characters dropped, parser resynced"
+    TRACE_EVENTS
+};
+
+static_assert(TRACE_EVENTS <= 0x40, "The event id is sent in 6 bits");
+
+void trace(TraceEvent event, int32_t a = 0, int32_t b = 0, int32_t c = 0);
+void trace_flush(void);
+
+#endif /* __TRACE_H__ */
@@ -0,0 +1,212 @@
+#include <Arduino.h>
+#include <lmic.h>
+#include "ui.h"
+#include "oled.h"
+
+/*
+ * Status screen.
+ *
+ * The LMIC events and the uplink job only update the fields of the UI model: battery,
+ * satellites, link and TX state. ui_loop() renders each row to text and redraws the
+ * rows whose text differs from the cached one, oled_flush() then sends the changed
+ * tiles only. Nothing is drawn while the panel is off, the rows are redrawn once it is
+ * switched on again.
+ *
+ * The link, TX and notification events switch the panel on; it is switched off
+ * UI_AUTO_OFF_S seconds after the last one by an LMIC job.
+ */
+
+#define UI_ROW_HEIGHT 10
+#define UI_TEXT_LEN 12
+
+enum UiRow
+{
+    UI_ROW_BATTERY,
+    UI_ROW_GPS,
+    UI_ROW_STATUS,
+    UI_ROWS,
+};
+
+static uint16_t ui_battery_mv = 0;
+static int ui_sats = UI_GPS_NONE;
+static UiLink ui_link = UI_LINK_JOINING;
+static UiTx ui_tx = UI_TX_IDLE;
+static const char *ui_note = nullptr;
+// Text of each row as drawn in the frame buffer
+static char ui_cache[UI_ROWS][UI_TEXT_LEN];
+static bool ui_clear = true;
+static bool ui_on = false;
+static osjob_t ui_off_job;
+
+/**
+ * @brief Renders a row of the status screen to text.
+ */
+static void ui_render(uint8_t row, char *text)
+{
+    switch (row)
+    {
+    case UI_ROW_BATTERY:
+        snprintf(text, UI_TEXT_LEN, "Batt: %u.%02u", ui_battery_mv / 1000, ui_battery_mv % 1000 / 10);
+        break;
+    case UI_ROW_GPS:
+        if (ui_sats == UI_GPS_SLEEP)
+            snprintf(text, UI_TEXT_LEN, "#GPS: Sleep");
+        else if (ui_sats == UI_GPS_NONE)
+            snprintf(text, UI_TEXT_LEN, "#GPS: N/A");
+        else
+            snprintf(text, UI_TEXT_LEN, "#GPS: %d", ui_sats);
+        break;
+    default:
+        if (ui_note != nullptr)
+            snprintf(text, UI_TEXT_LEN, "%s", ui_note);
+        else if (ui_link == UI_LINK_JOINING)
+            snprintf(text, UI_TEXT_LEN, "JOINING");
+        else if (ui_link == UI_LINK_JOIN_FAILED)
+            snprintf(text, UI_TEXT_LEN, "Join failed");
+        else if (ui_tx == UI_TX_SENDING)
+            snprintf(text, UI_TEXT_LEN, "Sending");
+        else if (ui_tx == UI_TX_SENT)
+            snprintf(text, UI_TEXT_LEN, "Sent");
+        else
+            snprintf(text, UI_TEXT_LEN, "Joined");
+        break;
+    }
+}
+
+/**
+ * @brief Switches the panel off, the LMIC job of the auto-off policy.
+ */
+static void ui_off(osjob_t *j)
+{
+    (void)j;
+    if (!ui_on)
+        return;
+    ui_on = false;
+    oled_power(false);
+}
+
+/**
+ * @brief Starts the status screen, after oled_init().
+ *
+ * The screen replaces the splash screen once it has faded in. The panel, switched on by
+ * oled_init(), goes off after UI_AUTO_OFF_S seconds unless an event keeps it on.
+ */
+void ui_init(void)
+{
+    for (uint8_t row = 0; row < UI_ROWS; row++)
+        ui_cache[row][0] = '\0';
+    ui_clear = true;
+    ui_note = nullptr;
+    os_clearCallback(&ui_off_job);
+    ui_on = true;
+    ui_wake();
+}
+
+/**
+ * @brief Redraws the rows that changed.
+ */
+void ui_loop(void)
+{
+    if (!ui_on || u8g2 == nullptr)
+        return;
+
+    // The splash screen stays until it has faded in
+    if (oled_busy())
+        return;
+
+    if (ui_clear)
+        u8g2->clearBuffer();
+    bool changed = ui_clear;
+    ui_clear = false;
+    u8g2->setFont(u8g2_font_IPAandRUSLCD_tr);
+    for (uint8_t row = 0; row < UI_ROWS; row++)
+    {
+        char text[UI_TEXT_LEN];
+        ui_render(row, text);
+        if (strcmp(text, ui_cache[row]) == 0)
+            continue;
+        strcpy(ui_cache[row], text);
+        u8g2->setDrawColor(0);
+        u8g2->drawBox(0, row * UI_ROW_HEIGHT, u8g2->getDisplayWidth(), UI_ROW_HEIGHT);
+        u8g2->setDrawColor(1);
+        u8g2->drawStr(0, row * UI_ROW_HEIGHT + 7, text);
+        changed = true;
+    }
+    if (changed)
+        oled_flush();
+}
+
+/**
+ * @brief Switches the panel on and restarts the auto-off delay.
+ */
+void ui_wake(void)
+{
+    if (!ui_on)
+    {
+        ui_on = true;
+        oled_power(true);
+    }
+    if (UI_AUTO_OFF_S > 0)
+        os_setTimedCallback(&ui_off_job, os_getTime() + sec2osticks(UI_AUTO_OFF_S), ui_off);
+}
+
+/**
+ * @brief Updates the battery voltage field.
+ *
+ * @param mv The battery voltage in mV.
+ */
+void ui_set_battery(uint16_t mv)
+{
+    ui_battery_mv = mv;
+}
+
+/**
+ * @brief Updates the satellites field.
+ *
+ * @param sats The satellites in use, UI_GPS_SLEEP or UI_GPS_NONE.
+ */
+void ui_set_gps(int sats)
+{
+    ui_sats = sats;
+}
+
+/**
+ * @brief Updates the link state, a change switches the panel on.
+ *
+ * @param link The link state.
+ */
+void ui_set_link(UiLink link)
+{
+    if (link == ui_link)
+        return;
+    ui_link = link;
+    ui_note = nullptr;
+    ui_wake();
+}
+
+/**
+ * @brief Updates the TX state, a change switches the panel on.
+ *
+ * @param tx The TX state.
+ */
+void ui_set_tx(UiTx tx)
+{
+    if (tx == ui_tx)
+        return;
+    ui_tx = tx;
+    ui_note = nullptr;
+    ui_wake();
+}
+
+/**
+ * @brief Shows a notification on the status row and switches the panel on.
+ *
+ * The notification stays until the next link or TX state change.
+ *
+ * @param text The notification, a string constant of up to 11 characters.
+ */
+void ui_notify(const char *text)
+{
+    ui_note = text;
+    ui_wake();
+}
@@ -0,0 +1,38 @@
+#ifndef __UI_H__
+#define __UI_H__
+
+#include <stdint.h>
+
+// The panel is powered down this long after the last UI event, 0 keeps it on
+#ifndef UI_AUTO_OFF_S
+#define UI_AUTO_OFF_S 2
+#endif
+
+// Satellites field when the GPS is asleep or not started
+#define UI_GPS_SLEEP -1
+#define UI_GPS_NONE -2
+
+enum UiLink
+{
+    UI_LINK_JOINING,
+    UI_LINK_JOIN_FAILED,
+    UI_LINK_JOINED,
+};
+
+enum UiTx
+{
+    UI_TX_IDLE,
+    UI_TX_SENDING,
+    UI_TX_SENT,
+};
+
+void ui_init(void);
+void ui_loop(void);
+void ui_wake(void);
+void ui_set_battery(uint16_t mv);
+void ui_set_gps(int sats);
+void ui_set_link(UiLink link);
+void ui_set_tx(UiTx tx);
+void ui_notify(const char *text);
+
+#endif /* __UI_H__ */
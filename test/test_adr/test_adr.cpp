@@ -0,0 +1,80 @@
+#include <unity.h>
+#include <lmic.h>
+#include "adr.h"
+
+/*
+ * Downlink SNR check of adr_update(), with the LMIC state it sees on EV_TXCOMPLETE.
+ */
+
+void setUp(void)
+{
+    memset(&LMIC, 0, sizeof(LMIC));
+    LMIC.datarate = DR_SF7;
+    LMIC.adrTxPow = ADR_TXPOW_MAX;
+    LMIC.dn2Dr = DR_SF12;
+    adr_init();
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief Reports a downlink received in a window, as the LMIC sets it up.
+ */
+static void downlink(uint8_t flags, uint8_t rx1_offset, int snr)
+{
+    LMIC.rx1DrOffset = rx1_offset;
+    // setupRx1() of the EU868 band plan applies the offset to the uplink data rate
+    LMIC.dndr = LMIC.datarate - rx1_offset;
+    LMIC.txrxFlags = flags;
+    LMIC.snr = snr * SNR_SCALEUP;
+    adr_update();
+}
+
+void test_rx1_margin_ok(void)
+{
+    // SF7 floor -7 dB
+    downlink(TXRX_DNW1, 0, -6);
+    TEST_ASSERT_EQUAL(DR_SF7, LMIC.datarate);
+}
+
+void test_rx1_margin_low(void)
+{
+    downlink(TXRX_DNW1, 0, -8);
+    TEST_ASSERT_EQUAL(DR_SF8, LMIC.datarate);
+}
+
+void test_rx1_offset_margin_low(void)
+{
+    // SF7 uplink, RX1 at SF9 (floor -12 dB): -14 dB is below it, though above the SF11
+    // floor an offset applied twice would check against
+    downlink(TXRX_DNW1, 2, -14);
+    TEST_ASSERT_EQUAL(DR_SF8, LMIC.datarate);
+}
+
+void test_rx1_offset_margin_ok(void)
+{
+    downlink(TXRX_DNW1, 2, -11);
+    TEST_ASSERT_EQUAL(DR_SF7, LMIC.datarate);
+}
+
+void test_rx2_margin(void)
+{
+    // RX2 at SF12 (floor -20 dB), whatever the RX1 offset
+    downlink(TXRX_DNW2, 2, -19);
+    TEST_ASSERT_EQUAL(DR_SF7, LMIC.datarate);
+    downlink(TXRX_DNW2, 2, -21);
+    TEST_ASSERT_EQUAL(DR_SF8, LMIC.datarate);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rx1_margin_ok);
+    RUN_TEST(test_rx1_margin_low);
+    RUN_TEST(test_rx1_offset_margin_low);
+    RUN_TEST(test_rx1_offset_margin_ok);
+    RUN_TEST(test_rx2_margin);
+    return UNITY_END();
+}
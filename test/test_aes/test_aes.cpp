@@ -0,0 +1,188 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+#include <time.h>
+#include <lmic.h>
+
+/*
+ * AES backend of the LMIC (os_aes()): test vectors and an uplink benchmark.
+ *
+ * The backend is chosen at build time, the native_aes_* environments build the other
+ * ones: pio test -e native -e native_aes_ibm -e native_aes_ideetron -f test_aes
+ */
+
+#if defined(USE_ORIGINAL_AES)
+#define AES_BACKEND "IBM (USE_ORIGINAL_AES)"
+#elif defined(USE_IDEETRON_AES)
+#define AES_BACKEND "Ideetron (USE_IDEETRON_AES)"
+#else
+#define AES_BACKEND "T-table (USE_TTABLE_AES)"
+#endif
+
+#define BENCH_UPLINKS 20000
+
+static const uint8_t rfc_key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const uint8_t rfc_msg[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+
+// LoRaWAN 1.0 uplink: DevAddr 49BE7DF1, FCnt 2, FPort 1, FRMPayload "test"
+static const uint8_t nwk_skey[16] = {0x44, 0x02, 0x42, 0x41, 0xed, 0x4c, 0xe9, 0xa6,
+                                     0x8c, 0x6a, 0x8b, 0xc0, 0x55, 0x23, 0x3f, 0xd3};
+static const uint8_t app_skey[16] = {0xec, 0x92, 0x58, 0x02, 0xae, 0x43, 0x0c, 0xa7,
+                                     0x7f, 0xd3, 0xdd, 0x73, 0xcb, 0x2c, 0xc5, 0x88};
+static const uint8_t uplink[17] = {0x40, 0xf1, 0x7d, 0xbe, 0x49, 0x00, 0x02, 0x00, 0x01,
+                                   0x95, 0x43, 0x78, 0x76, 0x2b, 0x11, 0xff, 0x0d};
+static const uint32_t devaddr = 0x49BE7DF1;
+
+/**
+ * @brief Runs os_aes() with a key, the IBM backend expands it in place on every call.
+ */
+static uint32_t aes(const uint8_t *key, uint8_t mode, uint8_t *buf, uint16_t len)
+{
+    memcpy(AESkey, key, 16);
+    return os_aes(mode, buf, len);
+}
+
+/**
+ * @brief Sets the B0 (MIC) or Ai (encryption) block of a frame in AESaux, like the LMIC.
+ */
+static void frame_block(uint8_t type, uint32_t fcnt, uint8_t last)
+{
+    memset(AESaux, 0, 16);
+    AESaux[0] = type;
+    os_wlsbf4(AESaux + 6, devaddr);
+    os_wlsbf4(AESaux + 10, fcnt);
+    AESaux[15] = last;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_fips197_block(void)
+{
+    uint8_t key[16], block[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+    static const uint8_t expected[16] = {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                                         0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a};
+    for (int i = 0; i < 16; i++)
+        key[i] = i;
+    aes(key, AES_ENC, block, 16);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, block, 16);
+}
+
+void test_rfc4493_cmac(void)
+{
+    // Examples 2 to 4, the first 32 bits as in a MIC. The LMIC never signs an empty
+    // message, example 1 does not apply.
+    uint8_t msg[64];
+    memcpy(msg, rfc_msg, sizeof(msg));
+    TEST_ASSERT_EQUAL_HEX32(0x070a16b4, aes(rfc_key, AES_MIC | AES_MICNOAUX, msg, 16));
+    TEST_ASSERT_EQUAL_HEX32(0xdfa66747, aes(rfc_key, AES_MIC | AES_MICNOAUX, msg, 40));
+    TEST_ASSERT_EQUAL_HEX32(0x51f0bebf, aes(rfc_key, AES_MIC | AES_MICNOAUX, msg, 64));
+    // The message is left unchanged
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rfc_msg, msg, sizeof(msg));
+}
+
+void test_lorawan_mic(void)
+{
+    uint8_t pdu[sizeof(uplink)];
+    memcpy(pdu, uplink, sizeof(pdu));
+    frame_block(0x49, 2, sizeof(pdu) - 4);
+    TEST_ASSERT_EQUAL_HEX32(os_rmsbf4(uplink + sizeof(uplink) - 4),
+                            aes(nwk_skey, AES_MIC, pdu, sizeof(pdu) - 4));
+    // Twice, a cached key schedule or CMAC subkey gives the same result
+    frame_block(0x49, 2, sizeof(pdu) - 4);
+    TEST_ASSERT_EQUAL_HEX32(os_rmsbf4(uplink + sizeof(uplink) - 4),
+                            aes(nwk_skey, AES_MIC, pdu, sizeof(pdu) - 4));
+}
+
+void test_lorawan_payload(void)
+{
+    uint8_t payload[4];
+    memcpy(payload, uplink + 9, sizeof(payload));
+    frame_block(0x01, 2, 1);
+    aes(app_skey, AES_CTR, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_MEMORY("test", payload, sizeof(payload));
+}
+
+void test_key_change(void)
+{
+    // The T-table backend caches two key schedules, a third key evicts one
+    uint8_t block[16];
+    uint8_t first[16];
+    memset(block, 0, sizeof(block));
+    aes(nwk_skey, AES_ENC, block, 16);
+    memcpy(first, block, sizeof(first));
+    memset(block, 0, sizeof(block));
+    aes(app_skey, AES_ENC, block, 16);
+    memset(block, 0, sizeof(block));
+    aes(rfc_key, AES_ENC, block, 16);
+    memset(block, 0, sizeof(block));
+    aes(nwk_skey, AES_ENC, block, 16);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(first, block, 16);
+}
+
+/**
+ * @brief Reads the time stamp counter, 0 where there is none.
+ */
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Time of the crypto of one uplink with a 20 byte payload: CTR and MIC.
+ */
+void test_bench_uplink(void)
+{
+    uint8_t pdu[13 + 20];
+    struct timespec t0, t1;
+    uint64_t c0, c1;
+    char msg[128];
+
+    memset(pdu, 0x5a, sizeof(pdu));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = cycles();
+    for (uint32_t i = 0; i < BENCH_UPLINKS; i++)
+    {
+        frame_block(0x01, i, 1);
+        aes(app_skey, AES_CTR, pdu + 13, 20);
+        frame_block(0x49, i, sizeof(pdu));
+        aes(nwk_skey, AES_MIC, pdu, sizeof(pdu));
+    }
+    c1 = cycles();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_UPLINKS;
+    if (c1 != c0)
+        snprintf(msg, sizeof(msg), "%s: %.0f ns, %.0f cycles (TSC) per uplink on the host",
+                 AES_BACKEND, ns, (double)(c1 - c0) / BENCH_UPLINKS);
+    else
+        snprintf(msg, sizeof(msg), "%s: %.0f ns per uplink on the host", AES_BACKEND, ns);
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fips197_block);
+    RUN_TEST(test_rfc4493_cmac);
+    RUN_TEST(test_lorawan_mic);
+    RUN_TEST(test_lorawan_payload);
+    RUN_TEST(test_key_change);
+    RUN_TEST(test_bench_uplink);
+    return UNITY_END();
+}
@@ -0,0 +1,113 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "fixlog.h"
+#include "session.h"
+#include "sim.h"
+
+/*
+ * Fix log order across the RAM and EEPROM rings, and after a reset, and the spacing of
+ * the spilled fixes.
+ */
+
+#define EEPROM_SLOTS ((DATA_EEPROM_BANK2_END + 1 - DATA_EEPROM_BASE - SESSION_EEPROM_SIZE) / sizeof(FixRecord))
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief Checks that the pending fixes are the ones numbered from first, oldest first.
+ */
+static void check_order(int32_t first)
+{
+    FixRecord fix;
+    for (uint16_t i = 0; i < fixlog_count(); i++)
+    {
+        TEST_ASSERT_TRUE(fixlog_get(i, &fix));
+        TEST_ASSERT_EQUAL(first + i, fix.lat);
+    }
+    TEST_ASSERT_FALSE(fixlog_get(fixlog_count(), &fix));
+}
+
+void test_spill_order(void)
+{
+    fixlog_init();
+    // Fills RAM, the EEPROM ring and wraps it
+    for (int32_t i = 0; i < (int32_t)(FIXLOG_RAM_SIZE + EEPROM_SLOTS + 10); i++)
+    {
+        sim_busy(FIXLOG_SPILL_S * 1000000ULL);
+        fixlog_add(i * 1e-6, 0, 0);
+    }
+    // One EEPROM slot stays free
+    TEST_ASSERT_EQUAL(FIXLOG_RAM_SIZE + EEPROM_SLOTS - 1, fixlog_count());
+    check_order(11);
+}
+
+void test_order_after_reset(void)
+{
+    // The EEPROM ring is scanned again, the RAM fixes are kept by the test
+    fixlog_init();
+    TEST_ASSERT_EQUAL(FIXLOG_RAM_SIZE + EEPROM_SLOTS - 1, fixlog_count());
+    check_order(11);
+}
+
+void test_consume(void)
+{
+    fixlog_consume(EEPROM_SLOTS);
+    TEST_ASSERT_EQUAL(FIXLOG_RAM_SIZE - 1, fixlog_count());
+    check_order(11 + EEPROM_SLOTS);
+    fixlog_init();
+    TEST_ASSERT_EQUAL(FIXLOG_RAM_SIZE - 1, fixlog_count());
+}
+
+void test_spill_spacing(void)
+{
+    // A fix a second: one in FIXLOG_SPILL_S is spilled when it leaves RAM
+    FixRecord fix;
+    fixlog_consume(fixlog_count());
+    for (int32_t i = 0; i <= FIXLOG_RAM_SIZE + 2 * FIXLOG_SPILL_S; i++)
+    {
+        sim_busy(1000000);
+        fixlog_add((1000 + i) * 1e-6, 0, 0);
+    }
+    TEST_ASSERT_EQUAL(FIXLOG_RAM_SIZE + 3, fixlog_count());
+    TEST_ASSERT_TRUE(fixlog_get(0, &fix));
+    TEST_ASSERT_EQUAL(1000, fix.lat);
+    TEST_ASSERT_TRUE(fixlog_get(1, &fix));
+    TEST_ASSERT_EQUAL(1000 + FIXLOG_SPILL_S, fix.lat);
+    TEST_ASSERT_TRUE(fixlog_get(2, &fix));
+    TEST_ASSERT_EQUAL(1000 + 2 * FIXLOG_SPILL_S, fix.lat);
+    // The spacing holds across a reset
+    fixlog_init();
+    for (int32_t i = 0; i < FIXLOG_SPILL_S - 1; i++)
+    {
+        sim_busy(1000000);
+        fixlog_add(0, 0, 0);
+    }
+    TEST_ASSERT_EQUAL(FIXLOG_RAM_SIZE + 3, fixlog_count());
+}
+
+void test_age(void)
+{
+    FixRecord fix = {0, 0, 0, 1000};
+    TEST_ASSERT_EQUAL(200, fixlog_age(&fix, 1200));
+    TEST_ASSERT_EQUAL(0, fixlog_age(&fix, 1000));
+    // The RTC went back after a power loss
+    TEST_ASSERT_EQUAL(0, fixlog_age(&fix, 10));
+}
+
+int main(int argc, char **argv)
+{
+    sim_eeprom_init();
+    UNITY_BEGIN();
+    RUN_TEST(test_spill_order);
+    RUN_TEST(test_order_after_reset);
+    RUN_TEST(test_consume);
+    RUN_TEST(test_spill_spacing);
+    RUN_TEST(test_age);
+    return UNITY_END();
+}
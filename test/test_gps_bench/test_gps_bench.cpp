@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <TinyGPS++.h>
+#include <unity.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark of the NMEA parser (TinyGPSPlus), replayed from gps_cxd5603.nmea a character
+ * at a time and in DMA sized spans, the path of gps.cpp. Both must decode the same fixes.
+ *
+ * The log follows the output of the CXD5603GF: the default sentence set of a cold start,
+ * the acknowledges of the start commands, then the GGA only profile of gps.cpp at 1 Hz,
+ * without a fix for a while and then with 275 fixes. It was synthesized from the
+ * datasheet formats, it stands in for a capture of the board.
+ */
+
+#define BENCH_RUNS 200
+#define LOG_FIXES 275
+// Half the DMA ring of gps.cpp, a span handed on the half and full transfer events
+#define BENCH_SPAN 512
+
+static char log_data[65536];
+static size_t log_len;
+
+/**
+ * @brief Loads the log next to this file.
+ */
+static void load_log(void)
+{
+    char path[512];
+    const char *dir = strrchr(__FILE__, '/');
+    int len = dir != nullptr ? dir - __FILE__ + 1 : 0;
+    snprintf(path, sizeof(path), "%.*sgps_cxd5603.nmea", len, __FILE__);
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    log_len = fread(log_data, 1, sizeof(log_data), f);
+    fclose(f);
+    TEST_ASSERT_TRUE(log_len > 0 && log_len < sizeof(log_data));
+}
+
+/**
+ * @brief Feeds the log to a parser a character at a time.
+ *
+ * @return The number of sentences with a fix.
+ */
+static uint32_t replay_chars(TinyGPSPlus *parser)
+{
+    for (size_t i = 0; i < log_len; i++)
+        parser->encode(log_data[i]);
+    return parser->sentencesWithFix();
+}
+
+/**
+ * @brief Feeds the log to a parser in spans, like the DMA reception of gps.cpp.
+ *
+ * @return The number of sentences with a fix.
+ */
+static uint32_t replay_spans(TinyGPSPlus *parser)
+{
+    for (size_t i = 0; i < log_len; i += BENCH_SPAN)
+        parser->encode(log_data + i, log_len - i < BENCH_SPAN ? log_len - i : BENCH_SPAN);
+    return parser->sentencesWithFix();
+}
+
+/**
+ * @brief Reads the time stamp counter, 0 where there is none.
+ */
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+void setUp(void)
+{
+    if (log_len == 0)
+        load_log();
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief Checks the last fix of the log: 4025.143438 N, 00342.433089 W, 652.8 m, 7 satellites.
+ */
+static void check_parser(TinyGPSPlus *parser)
+{
+    TEST_ASSERT_EQUAL(0, parser->failedChecksum());
+    TEST_ASSERT_EQUAL(log_len, parser->charsProcessed());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 40.4190573, parser->location.lat());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, -3.7072182, parser->location.lng());
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 652.8, parser->altitude.meters());
+    TEST_ASSERT_EQUAL(7, parser->satellites.value());
+}
+
+/**
+ * @brief Times BENCH_RUNS replays of the log and reports the throughput on the host.
+ */
+static void bench(const char *name, uint32_t (*replay)(TinyGPSPlus *parser))
+{
+    struct timespec t0, t1;
+    uint64_t c0, c1;
+    uint32_t fixes = 0;
+    char msg[160];
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = cycles();
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        TinyGPSPlus parser;
+        fixes += replay(&parser);
+    }
+    c1 = cycles();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    TEST_ASSERT_EQUAL(BENCH_RUNS * LOG_FIXES, fixes);
+
+    double s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    double chars = (double)log_len * BENCH_RUNS;
+    if (c1 != c0)
+        snprintf(msg, sizeof(msg), "%-9s %6.1f Mchars/s, %5.0f ns, %6.0f cycles (TSC) per fix", name,
+                 chars / s / 1e6, s * 1e9 / fixes, (double)(c1 - c0) / fixes);
+    else
+        snprintf(msg, sizeof(msg), "%-9s %6.1f Mchars/s, %5.0f ns per fix", name, chars / s / 1e6,
+                 s * 1e9 / fixes);
+    TEST_MESSAGE(msg);
+}
+
+void test_replay_chars(void)
+{
+    TinyGPSPlus parser;
+    TEST_ASSERT_EQUAL(LOG_FIXES, replay_chars(&parser));
+    check_parser(&parser);
+}
+
+void test_replay_spans(void)
+{
+    TinyGPSPlus parser;
+    TEST_ASSERT_EQUAL(LOG_FIXES, replay_spans(&parser));
+    check_parser(&parser);
+}
+
+/**
+ * @brief Parsing throughput of both paths, characters per second and time per fix.
+ */
+void test_bench_parser(void)
+{
+    bench("per char", replay_chars);
+    bench("spans", replay_spans);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_chars);
+    RUN_TEST(test_replay_spans);
+    RUN_TEST(test_bench_parser);
+    return UNITY_END();
+}
@@ -0,0 +1,216 @@
+#include <Arduino.h>
+// ARDUINO selects floats, a coordinate needs a double
+#define ARDUINOJSON_USE_DOUBLE 1
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "fixlog.h"
+#include "payload.h"
+
+/*
+ * Round trip of the compact payload through the host decoder, tools/payload_decoder.py.
+ *
+ * Each test encodes a sequence of frames, as the device sends them, and feeds them in
+ * order to one decoder run. The decoded positions must match the encoded ones within a
+ * quantization step.
+ */
+
+#define FRAMES_MAX 64
+#define LAT_STEP (180.0 / (1UL << PAYLOAD_POS_BITS))
+#define LNG_STEP (360.0 / (1UL << PAYLOAD_POS_BITS))
+
+struct Frame
+{
+    uint8_t data[PAYLOAD_BATCH_MAX_SIZE];
+    uint8_t len;
+};
+
+static Frame frames[FRAMES_MAX];
+static int frame_count;
+// Decoder output, one object per frame
+static DynamicJsonDocument decoded_doc(65536);
+static JsonArrayConst decoded;
+
+/**
+ * @brief Returns the path of the decoder, from the location of this file.
+ */
+static const char *decoder_path(void)
+{
+    static char path[512];
+    const char *dir = strrchr(__FILE__, '/');
+    int len = dir != nullptr ? dir - __FILE__ + 1 : 0;
+    snprintf(path, sizeof(path), "%.*s../../tools/payload_decoder.py", len, __FILE__);
+    return path;
+}
+
+/**
+ * @brief Runs the decoder on the frames encoded so far, decoded gets its output.
+ */
+static void decode_frames(void)
+{
+    char list[] = "/tmp/test_payload_XXXXXX";
+    char cmd[1024];
+    static char out[65536];
+    size_t len = 0;
+    int fd = mkstemp(list);
+    FILE *f = fdopen(fd, "w");
+
+    TEST_ASSERT_NOT_NULL(f);
+    for (int i = 0; i < frame_count; i++)
+    {
+        for (int j = 0; j < frames[i].len; j++)
+            fprintf(f, "%02x", frames[i].data[j]);
+        fputc('\n', f);
+    }
+    fclose(f);
+
+    // The JSON lines of the decoder, as one array
+    snprintf(cmd, sizeof(cmd), "python3 %s < %s", decoder_path(), list);
+    FILE *p = popen(cmd, "r");
+    TEST_ASSERT_NOT_NULL(p);
+    out[len++] = '[';
+    while (len < sizeof(out) - 2 && fgets(out + len, sizeof(out) - len - 2, p) != nullptr)
+    {
+        len += strlen(out + len);
+        out[len - 1] = ',';
+    }
+    out[len > 1 ? len - 1 : len++] = ']';
+    out[len] = '\0';
+    int status = pclose(p);
+    unlink(list);
+    if (len == 2 && status != 0)
+        TEST_IGNORE_MESSAGE("python3 is needed to run the decoder");
+
+    TEST_ASSERT_TRUE(deserializeJson(decoded_doc, out) == DeserializationError::Ok);
+    decoded = decoded_doc.as<JsonArrayConst>();
+    TEST_ASSERT_EQUAL(frame_count, decoded.size());
+}
+
+/**
+ * @brief Encodes a frame, acknowledged by the network if ack is set and it is confirmed.
+ *
+ * @return Whether the frame was sent confirmed.
+ */
+static bool send(bool fix, double lat, double lng, double alt, bool ack)
+{
+    bool confirmed;
+    Frame *frame = &frames[frame_count++];
+    frame->len = payload_encode(frame->data, fix, lat, lng, alt, false, 0x05, 3.7f, &confirmed);
+    if (ack && confirmed)
+        payload_ack();
+    return confirmed;
+}
+
+static void check_position(JsonVariantConst out, double lat, double lng, double alt)
+{
+    TEST_ASSERT_TRUE(out.containsKey("latitude"));
+    TEST_ASSERT_DOUBLE_WITHIN(LAT_STEP, lat, out["latitude"].as<double>());
+    TEST_ASSERT_DOUBLE_WITHIN(LNG_STEP, lng, out["longitude"].as<double>());
+    TEST_ASSERT_EQUAL((int)alt, out["altitude"].as<int>());
+}
+
+void setUp(void)
+{
+    payload_reset();
+    fixlog_consume(fixlog_count());
+    frame_count = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_absolute_then_deltas(void)
+{
+    TEST_ASSERT_TRUE(send(true, 40.416775, -3.703790, 650, true));
+    for (int i = 1; i <= 5; i++)
+        TEST_ASSERT_FALSE(send(true, 40.416775 + i * 1e-4, -3.703790 - i * 1e-4, 650 + i, true));
+    send(false, 0, 0, 0, true);
+    decode_frames();
+
+    TEST_ASSERT_EQUAL(11, frames[0].len);
+    TEST_ASSERT_EQUAL(7, frames[1].len);
+    check_position(decoded[0], 40.416775, -3.703790, 650);
+    for (int i = 1; i <= 5; i++)
+        check_position(decoded[i], 40.416775 + i * 1e-4, -3.703790 - i * 1e-4, 650 + i);
+    TEST_ASSERT_FALSE(decoded[6].containsKey("latitude"));
+    TEST_ASSERT_EQUAL(0x05, decoded[6]["channels"].as<int>());
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 3.7, decoded[6]["battery"].as<double>());
+}
+
+void test_unacked_absolute(void)
+{
+    // The ack of the first frame is lost: the next one is absolute again
+    TEST_ASSERT_TRUE(send(true, 48.8566, 2.3522, 35, false));
+    TEST_ASSERT_TRUE(send(true, 48.8567, 2.3523, 36, true));
+    send(true, 48.8568, 2.3524, 37, true);
+    decode_frames();
+
+    TEST_ASSERT_EQUAL(11, frames[1].len);
+    TEST_ASSERT_EQUAL(7, frames[2].len);
+    check_position(decoded[1], 48.8567, 2.3523, 36);
+    check_position(decoded[2], 48.8568, 2.3524, 37);
+}
+
+void test_moving_fast_unconfirmed(void)
+{
+    TEST_ASSERT_TRUE(send(true, 10.0, 20.0, 100, true));
+    // Out of delta range of the previous fix each time
+    for (int i = 1; i <= 4; i++)
+        TEST_ASSERT_FALSE(send(true, 10.0 + i * 0.1, 20.0, 100, true));
+    // Slowing down: the absolute frame can start deltas again
+    TEST_ASSERT_TRUE(send(true, 10.4001, 20.0, 100, true));
+    TEST_ASSERT_FALSE(send(true, 10.4002, 20.0, 100, true));
+    decode_frames();
+
+    for (int i = 0; i <= 4; i++)
+        check_position(decoded[i], 10.0 + i * 0.1, 20.0, 100);
+    TEST_ASSERT_EQUAL(7, frames[6].len);
+    check_position(decoded[6], 10.4002, 20.0, 100);
+}
+
+void test_tag_wrap(void)
+{
+    // Reference acked, then more than 16 absolute frames without an ack
+    TEST_ASSERT_TRUE(send(true, -33.8688, 151.2093, 58, true));
+    for (int i = 1; i <= 20; i++)
+        send(true, -33.8688 + i * 0.05, 151.2093, 58, false);
+    // Back near the reference: a delta against the acked frame
+    send(true, -33.8689, 151.2094, 59, true);
+    decode_frames();
+
+    TEST_ASSERT_EQUAL(7, frames[21].len);
+    check_position(decoded[21], -33.8689, 151.2094, 59);
+}
+
+void test_batch(void)
+{
+    for (int i = 0; i < 10; i++)
+        fixlog_add(51.5074 + i * 1e-4, -0.1278 + (i == 5 ? 1.0 : 0), 11 + i);
+    uint16_t count;
+    Frame *frame = &frames[frame_count++];
+    frame->len = payload_encode_batch(frame->data, 51, true, 0x07, 3.9f, &count);
+    decode_frames();
+
+    JsonArrayConst fixes = decoded[0]["fixes"].as<JsonArrayConst>();
+    TEST_ASSERT_TRUE(decoded[0]["interior"].as<bool>());
+    TEST_ASSERT_TRUE(count > 0 && count < 10);
+    TEST_ASSERT_EQUAL(count, fixes.size());
+    for (int i = 0; i < count; i++)
+    {
+        check_position(fixes[i], 51.5074 + i * 1e-4, -0.1278 + (i == 5 ? 1.0 : 0), 11 + i);
+        TEST_ASSERT_EQUAL(0, fixes[i]["age"].as<int>());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_absolute_then_deltas);
+    RUN_TEST(test_unacked_absolute);
+    RUN_TEST(test_moving_fast_unconfirmed);
+    RUN_TEST(test_tag_wrap);
+    RUN_TEST(test_batch);
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Host side decoder of the compact uplink payload (src/payload.cpp, port 2).
+
+Delta frames refer to an absolute frame by its 4-bit tag, so the decoder keeps
+the absolute positions it has seen. The device does not reuse the tag of its
+reference for new absolute frames. Feed it every frame of a device in order.
+Batch frames are self-contained, each fix has its age in seconds before the uplink.
+
+Usage: payload_decoder.py [--pos-bits N] [--delta-bits N] < frames.txt
+with one hex encoded frame per line.
+"""
+
+import argparse
+import json
+import sys
+
+TYPE_NOFIX = 0
+TYPE_ABS = 1
+TYPE_DELTA = 2
+TYPE_BATCH = 3
+
+ALT_OFFSET = 1000
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def get(self, bits, signed=False):
+        if self.pos + bits > len(self.data) * 8:
+            raise ValueError("frame too short")
+        value = 0
+        for _ in range(bits):
+            byte = self.data[self.pos >> 3]
+            value = (value << 1) | ((byte >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        if signed and value & (1 << (bits - 1)):
+            value -= 1 << bits
+        return value
+
+
+class CompactDecoder:
+    def __init__(self, pos_bits=24, delta_bits=12):
+        self.pos_bits = pos_bits
+        self.delta_bits = delta_bits
+        self.refs = {}  # tag -> (lat, lng, alt) in quantized steps
+
+    def _degrees(self, q, span):
+        # Center of the quantization step
+        return (q + 0.5) * span / (1 << self.pos_bits) - span / 2
+
+    def _fix(self, pos, age):
+        return {
+            "latitude": self._degrees(pos[0], 180),
+            "longitude": self._degrees(pos[1], 360),
+            "altitude": pos[2],
+            "age": age,
+        }
+
+    def _decode_batch(self, r):
+        fixes = []
+        pos = None
+        age = 0
+        for _ in range(r.get(6)):
+            if r.get(1):
+                if pos is None:
+                    raise ValueError("batch starts with a delta")
+                pos = (pos[0] + r.get(self.delta_bits, True),
+                       pos[1] + r.get(self.delta_bits, True),
+                       pos[2] + r.get(8, True))
+                age -= r.get(12)
+            else:
+                pos = (r.get(self.pos_bits), r.get(self.pos_bits), r.get(16) - ALT_OFFSET)
+                age = r.get(16)
+            fixes.append(self._fix(pos, age))
+        return fixes
+
+    def decode(self, frame):
+        r = BitReader(frame)
+        ftype = r.get(2)
+        out = {
+            "interior": bool(r.get(1)),
+            "battery": round(3.0 + r.get(4) * 0.1, 1),
+            "channels": r.get(8),
+        }
+        if ftype == TYPE_BATCH:
+            out["fixes"] = self._decode_batch(r)
+            return out
+        tag = r.get(4)
+        if ftype == TYPE_ABS:
+            pos = (r.get(self.pos_bits), r.get(self.pos_bits), r.get(16) - ALT_OFFSET)
+            self.refs[tag] = pos
+        elif ftype == TYPE_DELTA:
+            if tag not in self.refs:
+                raise ValueError("unknown reference tag %d" % tag)
+            ref = self.refs[tag]
+            pos = (ref[0] + r.get(self.delta_bits, True),
+                   ref[1] + r.get(self.delta_bits, True),
+                   ref[2] + r.get(8, True))
+        elif ftype == TYPE_NOFIX:
+            return out
+        else:
+            raise ValueError("unknown frame type %d" % ftype)
+        out["latitude"] = self._degrees(pos[0], 180)
+        out["longitude"] = self._degrees(pos[1], 360)
+        out["altitude"] = pos[2]
+        return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--pos-bits", type=int, default=24)
+    parser.add_argument("--delta-bits", type=int, default=12)
+    args = parser.parse_args()
+
+    decoder = CompactDecoder(args.pos_bits, args.delta_bits)
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+        try:
+            print(json.dumps(decoder.decode(bytes.fromhex(line))))
+        except ValueError as err:
+            print(json.dumps({"error": str(err), "frame": line}))
+
+
+if __name__ == "__main__":
+    main()
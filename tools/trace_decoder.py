@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Host side decoder of the binary trace log (src/trace.cpp).
+
+The serial output mixes ASCII text and trace records. A record is 25 bytes with bit 7
+set: 0xC0 | event id, then the time and three arguments as 32-bit values, 0x80 | 6 bits
+per byte, least significant first. Only the first byte has bit 6 set, a record cut
+short by a lost byte is reported and decoding resumes at the next one. The event names
+and formats are read from src/trace.h. Text is passed through unchanged.
+
+Usage: trace_decoder.py [--header src/trace.h] [--tick-hz 62500] [FILE]
+reading FILE (a capture, or the serial device in raw mode) or stdin.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+VALUE_BYTES = 6
+FRAME_LEN = 1 + 4 * VALUE_BYTES
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "trace.h")
+
+
+def load_events(path):
+    """Returns the (name, format) of each event of the TraceEvent enum, in id order."""
+    events = []
+    with open(path) as f:
+        for line in f:
+            m = re.match(r'\s*(TRACE_\w+),\s*//\s*"(.*)"', line)
+            if m:
+                events.append((m.group(1), m.group(2)))
+    return events
+
+
+def value(frame, i):
+    v = 0
+    for b in reversed(frame[i:i + VALUE_BYTES]):
+        v = (v << 6) | (b & 0x3F)
+    return v & 0xFFFFFFFF
+
+
+def signed(v):
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def decode(frame, events, tick_hz):
+    event = frame[0] & 0x3F
+    time = value(frame, 1) / tick_hz
+    args = [signed(value(frame, 1 + VALUE_BYTES * (i + 1))) for i in range(3)]
+    if event >= len(events):
+        return "[%11.6f] unknown trace event %d %r" % (time, event, args)
+    name, fmt = events[event]
+    nargs = len(re.findall(r"%[-0-9.]*[dxXuc]", fmt))
+    return "[%11.6f] %s" % (time, fmt % tuple(args[:nargs]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--header", default=DEFAULT_HEADER)
+    parser.add_argument("--tick-hz", type=int, default=62500)
+    parser.add_argument("file", nargs="?")
+    args = parser.parse_args()
+
+    events = load_events(args.header)
+    stream = open(args.file, "rb") if args.file else sys.stdin.buffer
+    out = sys.stdout
+    text = bytearray()
+    frame = bytearray()
+    lost = 0
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not chunk:
+            break
+        for b in chunk:
+            if b & 0xC0 == 0xC0:
+                if frame:
+                    out.write("[truncated trace record]\n")
+                if lost:
+                    out.write("[%d trace bytes without a record start]\n" % lost)
+                    lost = 0
+                frame[:] = [b]
+                continue
+            if b & 0x80:
+                if not frame:
+                    lost += 1
+                    continue
+                frame.append(b)
+                if len(frame) == FRAME_LEN:
+                    out.write(decode(frame, events, args.tick_hz) + "\n")
+                    frame.clear()
+                continue
+            if frame:
+                out.write("[truncated trace record]\n")
+                frame.clear()
+            if lost:
+                out.write("[%d trace bytes without a record start]\n" % lost)
+                lost = 0
+            text.append(b)
+            if b == 0x0A:
+                out.write(text.decode("ascii", "replace"))
+                text.clear()
+        out.flush()
+    if text:
+        out.write(text.decode("ascii", "replace"))
+
+
+if __name__ == "__main__":
+    main()